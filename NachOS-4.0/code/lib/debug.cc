@@ -18,28 +18,29 @@
 //
 //	If the flag is "+", we enable all DEBUG messages.
 //
+//	The list is turned into a bitmask here, once, so that 
+//	IsEnabled (see debug.h) is a single test.
+//
 // 	"flagList" is a string of characters for whose DEBUG messages are 
 //		to be enabled.
 //----------------------------------------------------------------------
 
 Debug::Debug(char *flagList)
 {
-    enableFlags = flagList;
-}
-
-
-//----------------------------------------------------------------------
-// Debug::IsEnabled
-//      Return TRUE if DEBUG messages with "flag" are to be printed.
-//----------------------------------------------------------------------
+    int i;
+    unsigned char f;
 
-bool
-Debug::IsEnabled(char flag)
-{
-    if (enableFlags != NULL) {
-	return ((strchr(enableFlags, flag) != 0) 
-		|| (strchr(enableFlags, '+') != 0));
-    } else {
-    	return FALSE;
+    for (i = 0; i < 256 / 32; i++)
+	enableMask[i] = 0;
+    if (flagList == NULL)
+	return;
+    if (strchr(flagList, dbgAll) != 0) {
+	for (i = 0; i < 256 / 32; i++)
+	    enableMask[i] = ~0;
+	return;
+    }
+    for (i = 0; flagList[i] != '\0'; i++) {
+	f = (unsigned char) flagList[i];
+	enableMask[f >> 5] |= 1u << (f & 0x1f);
     }
 }
@@ -29,15 +29,23 @@ const char dbgFile = 'f'; 		// file system
 const char dbgAddr = 'a'; 		// address spaces
 const char dbgNet = 'n'; 		// network emulation
 const char dbgSys = 'u';                // systemcall
+const char dbgPool = 'p';		// object pools (statistics on halt)
+const char dbgPaging = 'v';		// paging of each process (statistics
+					// on halt)
 
 class Debug {
   public:
     Debug(char *flagList);
 
-    bool IsEnabled(char flag);
+    bool IsEnabled(char flag) {
+	unsigned char f = (unsigned char) flag;
+	return (enableMask[f >> 5] >> (f & 0x1f)) & 1;
+    }
 
   private:
-    char *enableFlags;		// controls which DEBUG messages are printed
+    unsigned int enableMask[256 / 32];
+    				// bit i is set if DEBUG messages with
+				// flag i are printed
 };
 
 extern Debug *debug;
@@ -52,6 +60,18 @@ extern Debug *debug;
         cerr << expr << "\n";   				        \
     }
 
+//----------------------------------------------------------------------
+// HOTDEBUG
+//      Like DEBUG, but for messages on the simulator's per-instruction
+//	path (address translation, memory access).  Compiled out
+//	entirely if NO_HOT_DEBUG is defined (see "make release").
+//----------------------------------------------------------------------
+#ifdef NO_HOT_DEBUG
+#define HOTDEBUG(flag,expr)
+#else
+#define HOTDEBUG(flag,expr)	DEBUG(flag,expr)
+#endif
+
 
 //----------------------------------------------------------------------
 // ASSERT
@@ -1,6 +1,7 @@
 // libtest.cc 
 //	Driver code to call self-test routines for standard library
-//	classes -- bitmaps, lists, sorted lists, and hash tables.
+//	classes -- bitmaps, lists, sorted lists, intrusive lists, and
+//	hash tables.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -53,6 +54,14 @@ HashKey(char *str) {
 // Array of values to be inserted into a List or SortedList. 
 static int listTestVector[] = { 9, 5, 7 };
 
+// Objects to be linked into an IntrusiveList.
+class LinkedInt {
+  public:
+    int value;
+    ListLink<LinkedInt> link;
+};
+static LinkedInt linkedTestItems[5];
+
 // Array of values to be inserted into the HashTable
 // There are enough here to force a ReHash().
 static char *hashTestVector[] = { "0", "1", "2", "3", "4", "5", "6",
@@ -60,8 +69,8 @@ static char *hashTestVector[] = { "0", "1", "2", "3", "4", "5", "6",
 
 //----------------------------------------------------------------------
 // LibSelfTest
-//	Run self tests on bitmaps, lists, sorted lists, and 
-//	hash tables.
+//	Run self tests on bitmaps, lists, sorted lists, intrusive
+//	lists, and hash tables.
 //----------------------------------------------------------------------
 
 void
@@ -71,15 +80,26 @@ LibSelfTest () {
     SortedList<int> *sortList = new SortedList<int>(IntCompare);
     HashTable<int, char *> *hashTable = 
 	new HashTable<int, char *>(HashKey, HashInt);
+    IntrusiveList<LinkedInt, &LinkedInt::link> *linkedList =
+	new IntrusiveList<LinkedInt, &LinkedInt::link>;
+    LinkedInt *linkedTestVector[5];
+    int i;
+
+    for (i = 0; i < 5; i++) {
+	linkedTestItems[i].value = i;
+	linkedTestVector[i] = &linkedTestItems[i];
+    }
 	
 		
     map->SelfTest();
     list->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
     sortList->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
     hashTable->SelfTest(hashTestVector, sizeof(hashTestVector)/sizeof(char *));
+    linkedList->SelfTest(linkedTestVector, 5);
 
     delete map;
     delete list;
     delete sortList;
     delete hashTable;
+    delete linkedList;
 }
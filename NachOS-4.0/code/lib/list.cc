@@ -18,6 +18,9 @@
 
 #include "copyright.h"
 
+template <class T>
+__thread Pool *ListElement<T>::pool = NULL;
+
 //----------------------------------------------------------------------
 // ListElement<T>::ListElement
 // 	Initialize a list element, so it can be added somewhere on a list.
@@ -381,3 +384,207 @@ SortedList<T>::SelfTest(T *p, int numEntries)
 
      delete q;
 }
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::IntrusiveList
+//	Initialize an intrusive list, empty to start with.
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*Link>
+IntrusiveList<T, Link>::IntrusiveList()
+{ 
+    first = last = NULL; 
+    numInList = 0;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::~IntrusiveList
+//	Prepare a list for deallocation.  The objects on it aren't
+//	ours to delete, but we do take them off the list.
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*Link>
+IntrusiveList<T, Link>::~IntrusiveList()
+{ 
+    while (!IsEmpty()) {
+	(void) RemoveFront();
+    }
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::InsertBefore
+//      Link "item" into the list just before "before", or at the end
+//	of the list if "before" is NULL.  "item" must not be on any
+//	list (using the same links) already.
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*Link>
+void
+IntrusiveList<T, Link>::InsertBefore(T *item, T *before)
+{
+    ListLink<T> *link = &(item->*Link);
+
+    ASSERT(link->owner == NULL);
+    ASSERT((before == NULL) || IsInList(before));
+    link->owner = this;
+    link->next = before;
+    link->prev = (before == NULL) ? last : (before->*Link).prev;
+    if (link->prev == NULL) {
+	first = item;
+    } else {
+	(link->prev->*Link).next = item;
+    }
+    if (before == NULL) {
+	last = item;
+    } else {
+	(before->*Link).prev = item;
+    }
+    numInList++;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::Prepend, Append
+//      Put an item on the front, or the back, of the list.
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*Link>
+void
+IntrusiveList<T, Link>::Prepend(T *item)
+{
+    InsertBefore(item, first);
+}
+
+template <class T, ListLink<T> T::*Link>
+void
+IntrusiveList<T, Link>::Append(T *item)
+{
+    InsertBefore(item, NULL);
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::Remove
+//      Unlink a specific item from the list.  Must be in the list!
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*Link>
+void
+IntrusiveList<T, Link>::Remove(T *item)
+{
+    ListLink<T> *link = &(item->*Link);
+
+    ASSERT(IsInList(item));
+    if (link->prev == NULL) {
+	first = link->next;
+    } else {
+	(link->prev->*Link).next = link->next;
+    }
+    if (link->next == NULL) {
+	last = link->prev;
+    } else {
+	(link->next->*Link).prev = link->prev;
+    }
+    link->next = link->prev = NULL;
+    link->owner = NULL;
+    numInList--;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::RemoveFront
+//      Remove the first item from the front of the list, and return
+//	it.  The list must not be empty.
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*Link>
+T *
+IntrusiveList<T, Link>::RemoveFront()
+{
+    T *item = first;
+
+    ASSERT(!IsEmpty());
+    Remove(item);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::Apply
+//      Apply function to every item on a list.
+//
+//	"func" -- the function to apply
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*Link>
+void
+IntrusiveList<T, Link>::Apply(void (*func)(T *)) const
+{ 
+    for (T *item = first; item != NULL; item = (item->*Link).next) {
+	(*func)(item);
+    }
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::SanityCheck
+//      Test whether this is still a legal list.
+//
+//	Tests: do the forward and backward links agree?
+//	       does every item on the list know it is on it?
+//	       does the list have the right # of elements?
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*Link>
+void
+IntrusiveList<T, Link>::SanityCheck() const
+{
+    T *item, *prev = NULL;
+    int numFound = 0;
+
+    for (item = first; item != NULL; item = (item->*Link).next) {
+	numFound++;
+	ASSERT(numFound <= numInList);	// prevent infinite loop
+	ASSERT((item->*Link).prev == prev);
+	ASSERT(IsInList(item));
+	prev = item;
+    }
+    ASSERT(numFound == numInList);
+    ASSERT(last == prev);
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList<T, Link>::SelfTest
+//      Test whether this module is working.
+//----------------------------------------------------------------------
+
+template <class T, ListLink<T> T::*Link>
+void
+IntrusiveList<T, Link>::SelfTest(T **p, int numEntries)
+{
+    int i;
+
+    SanityCheck();
+    ASSERT(IsEmpty() && (first == NULL));
+
+    for (i = 0; i < numEntries; i++) {
+	Append(p[i]);
+	ASSERT(IsInList(p[i]));
+	ASSERT(!IsEmpty());
+    }
+    SanityCheck();
+
+    // take them out of the middle, then put them back in order
+    for (i = 1; i < numEntries; i += 2) {
+	Remove(p[i]);
+	ASSERT(!IsInList(p[i]));
+    }
+    SanityCheck();
+    for (i = 1; i < numEntries; i += 2) {
+	InsertBefore(p[i], (i + 1 < numEntries) ? p[i + 1] : NULL);
+    }
+    SanityCheck();
+
+    // should get everything out, in the order we put it in
+    for (i = 0; i < numEntries; i++) {
+	ASSERT(RemoveFront() == p[i]);
+	ASSERT(!IsInList(p[i]));
+    }
+    ASSERT(IsEmpty());
+    SanityCheck();
+}
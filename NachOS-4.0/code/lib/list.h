@@ -15,6 +15,9 @@
 
 #include "copyright.h"
 #include "debug.h"
+#include "pool.h"
+
+#include <typeinfo>
 
 // The following class defines a "list element" -- which is
 // used to keep track of one item on a list.  It is equivalent to a
@@ -30,6 +33,14 @@ class ListElement {
     ListElement(T itm); 	// initialize a list element
     ListElement *next;	     	// next element on list, NULL if this is last
     T item; 	   	     	// item on the list
+
+    void *operator new(size_t size)	// list elements are kept in a pool,
+					// one for each type of item
+	{ return PoolAllocate(&pool, "ListElement", size, typeid(T).name()); }
+    void operator delete(void *element) { PoolFree(pool, element); }
+
+  private:
+    static __thread Pool *pool;	// this host thread's list elements
 };
 
 // The following class defines a "list" -- a singly linked list of
@@ -109,6 +120,71 @@ class SortedList : public List<T> {
 
 };
 
+// The following classes define an "intrusive list" -- a doubly linked
+// list of objects, where the links are kept in the objects themselves
+// (in a ListLink member) rather than in a separately allocated
+// ListElement.  So putting an object on a list, or taking it off,
+// allocates nothing, and removing an object from the middle of the
+// list doesn't need a search.  The catch is that an object can only
+// be on one list per ListLink it has.
+//
+// The list is told which member holds the links, for example:
+//
+//	class Thread { ... ListLink<Thread> queueLink; ... };
+//	IntrusiveList<Thread, &Thread::queueLink> *readyList;
+
+template <class T>
+class ListLink {
+  public:
+    ListLink() { next = prev = NULL; owner = NULL; }
+    				// not on any list
+
+    T *next;			// next object on the list, or NULL
+    T *prev;			// previous object on the list, or NULL
+    void *owner;		// the list the object is on, or NULL
+};
+
+template <class T, ListLink<T> T::*Link>
+class IntrusiveList {
+  public:
+    IntrusiveList();		// initialize the list
+    ~IntrusiveList();		// de-allocate the list; any objects
+				// still on it are taken off
+
+    void Prepend(T *item);	// Put item at the beginning of the list
+    void Append(T *item);	// Put item at the end of the list
+    void InsertBefore(T *item, T *before);
+    				// Put item just before "before" (at the
+				// end of the list, if "before" is NULL)
+
+    T *Front() { return first; }
+    				// Return first item on list (NULL if 
+				// empty), without removing it
+    T *Next(T *item) { return (item->*Link).next; }
+    				// Return the item after "item", or NULL
+    T *RemoveFront(); 		// Take item off the front of the list
+    void Remove(T *item); 	// Remove specific item from list
+
+    bool IsInList(T *item) const { return (item->*Link).owner == this; }
+    				// is the item in the list?
+    unsigned int NumInList() { return numInList; }
+    				// how many items in the list?
+    bool IsEmpty() { return (numInList == 0); }
+    				// is the list empty? 
+
+    void Apply(void (*f)(T *)) const; 
+    				// apply function to all elements in list
+
+    void SanityCheck() const;	// has this list been corrupted?
+    void SelfTest(T **p, int numEntries);
+				// verify module is working
+
+  private:
+    T *first;			// Head of the list, NULL if list is empty
+    T *last;			// Last element of list
+    int numInList;		// number of elements in list
+};
+
 // The following class can be used to step through a list. 
 // Example code:
 //	ListIterator<T> *iter(list); 
@@ -0,0 +1,182 @@
+// pool.cc 
+//	Routines to manage pools of fixed-size objects (see pool.h).
+
+#include "debug.h"
+#include "pool.h"
+
+#include <cxxabi.h>
+
+// The pools of this host thread, for PrintPools.
+static __thread Pool *allPools = NULL;
+
+// Objects are aligned to this, as the heap would align them.
+static const int PoolAlignment = 8;
+
+//----------------------------------------------------------------------
+// Pool::Pool
+// 	Initialize an empty pool of objects of "objectSize" bytes.
+//
+//	"poolName" is the kind of object, for printing statistics
+//	"typeName" is the (mangled) name of the type parameter, if the
+//		kind of object is a class template, or NULL
+//----------------------------------------------------------------------
+
+Pool::Pool(char *poolName, int objectSize, const char *typeName)
+{
+    ASSERT(objectSize > 0);
+    if (typeName == NULL) {
+	name = new char[strlen(poolName) + 1];
+	strcpy(name, poolName);
+    } else {
+	int status;
+	char *demangled = abi::__cxa_demangle(typeName, NULL, NULL, &status);
+	const char *param = (status == 0) ? demangled : typeName;
+
+	name = new char[strlen(poolName) + strlen(param) + 3];
+	sprintf(name, "%s<%s>", poolName, param);
+	free(demangled);		// allocated with malloc
+    }
+    size = divRoundUp(objectSize, PoolAlignment) * PoolAlignment;
+    if (size < (int) sizeof(FreeObject))
+	size = sizeof(FreeObject);
+    freeList = NULL;
+    slabs = NULL;
+    numAllocs = numHits = numSlabs = 0;
+    numInUse = maxInUse = 0;
+
+    nextPool = allPools;
+    allPools = this;
+}
+
+//----------------------------------------------------------------------
+// Pool::~Pool
+// 	Give the pool's memory back to the heap.  Any objects still
+//	in use become invalid.
+//----------------------------------------------------------------------
+
+Pool::~Pool()
+{
+    Pool **ptr;
+
+    while (slabs != NULL) {
+	char *slab = slabs;
+	slabs = *(char **) slab;
+	delete [] slab;
+    }
+    for (ptr = &allPools; *ptr != this; ptr = &(*ptr)->nextPool)
+	ASSERT(*ptr != NULL);
+    *ptr = nextPool;
+    delete [] name;
+}
+
+//----------------------------------------------------------------------
+// Pool::Allocate
+// 	Return memory for one object: from the free list if we can, or
+//	else from a new slab (whose other objects go on the free list).
+//----------------------------------------------------------------------
+
+void *
+Pool::Allocate()
+{
+    FreeObject *object;
+
+    numAllocs++;
+    if (freeList != NULL) {
+	numHits++;
+    } else {
+	// the first PoolAlignment bytes of a slab link it to the others
+	char *slab = new char[PoolAlignment + ObjectsPerSlab * size];
+
+	*(char **) slab = slabs;
+	slabs = slab;
+	numSlabs++;
+	for (int i = ObjectsPerSlab - 1; i >= 0; i--) {
+	    object = (FreeObject *) (slab + PoolAlignment + i * size);
+	    object->next = freeList;
+	    freeList = object;
+	}
+    }
+    object = freeList;
+    freeList = object->next;
+    if (++numInUse > maxInUse)
+	maxInUse = numInUse;
+    return (void *) object;
+}
+
+//----------------------------------------------------------------------
+// Pool::Free
+// 	Put "ptr", which came from Allocate, back on the free list.
+//----------------------------------------------------------------------
+
+void
+Pool::Free(void *ptr)
+{
+    FreeObject *object = (FreeObject *) ptr;
+
+    ASSERT(numInUse > 0);
+    object->next = freeList;
+    freeList = object;
+    numInUse--;
+}
+
+//----------------------------------------------------------------------
+// Pool::Print
+// 	Print how the pool has been used.
+//----------------------------------------------------------------------
+
+void
+Pool::Print()
+{
+    char line[160];
+
+    sprintf(line, "%-24s %4d bytes: %9d allocations, %6.2f%% hits, "
+		"%4d slabs, %6d in use (%d at most)\n", name, size, numAllocs,
+		(numAllocs > 0) ? (100.0 * numHits) / numAllocs : 0.0,
+		numSlabs, numInUse, maxInUse);
+    cout << line;
+}
+
+//----------------------------------------------------------------------
+// PoolAllocate
+// 	Return memory for an object of "size" bytes from "*pool",
+//	first making the pool if need be.  For a class's operator new.
+//
+//	"pool" is the class's pool for this host thread, or NULL
+//	"name" is the name of the class
+//	"typeName" is typeid(T).name(), for a class template of T, or NULL
+//----------------------------------------------------------------------
+
+void *
+PoolAllocate(Pool **pool, char *name, int size, const char *typeName)
+{
+    if (*pool == NULL)
+	*pool = new Pool(name, size, typeName);
+    ASSERT(size <= (*pool)->Size());
+    return (*pool)->Allocate();
+}
+
+//----------------------------------------------------------------------
+// PoolFree
+// 	Put "object" back in "pool".  For a class's operator delete;
+//	deleting NULL does nothing.
+//----------------------------------------------------------------------
+
+void
+PoolFree(Pool *pool, void *object)
+{
+    if (object != NULL)
+	pool->Free(object);
+}
+
+//----------------------------------------------------------------------
+// PrintPools
+// 	Print the statistics of every pool of this host thread.
+//----------------------------------------------------------------------
+
+void
+PrintPools()
+{
+    cout << "Object pools:\n";
+    for (Pool *pool = allPools; pool != NULL; pool = pool->nextPool)
+	pool->Print();
+}
@@ -0,0 +1,78 @@
+// pool.h 
+//	Data structures for a pool allocator: a cache of fixed-size
+//	objects, carved out of larger blocks of memory ("slabs").
+//
+//	Objects that are allocated and freed over and over -- pending
+//	interrupts, list elements, network messages -- can be kept in a
+//	pool by giving their class its own operator new and delete,
+//	which call PoolAllocate and PoolFree.  A freed object goes on
+//	the pool's free list, and the next allocation takes it from
+//	there, without going to the C++ heap.  Memory in a pool is never
+//	given back to the heap.
+//
+//	Each host thread (each machine of a -farm) has its own pools, so
+//	no locking is needed; an object must be freed by the host thread
+//	that allocated it.
+//
+//	Each pool counts how often an allocation was found on the free
+//	list (a "hit"); the counts are printed when Nachos halts with
+//	the "p" debugging flag on.  A class template has a pool for each
+//	of its instances, printed with the instance's type parameter
+//	(for example, "ListElement<Thread*>").
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "utility.h"
+
+// The number of objects to carve out of each slab.
+const int ObjectsPerSlab = 64;
+
+// The following class defines a pool of objects of one size.
+
+class Pool {
+  public:
+    Pool(char *name, int objectSize, const char *typeName = NULL);
+    				// Initialize an empty pool
+    ~Pool();			// Give all the slabs back
+
+    void *Allocate();		// Return an object's worth of memory
+    void Free(void *object);	// Put an object back in the pool
+
+    void Print();		// Print the pool's statistics
+    int Size() { return size; }	// How big the objects can be
+
+    Pool *nextPool;		// the other pools of this host thread
+
+  private:
+    class FreeObject {		// what is kept in a free object
+      public:
+	FreeObject *next;
+    };
+
+    char *name;			// for printing (our own copy)
+    int size;			// bytes per object (rounded up)
+    FreeObject *freeList;	// objects ready to hand out
+    char *slabs;		// all the slabs, linked through their
+				// first word
+
+    int numAllocs;		// # of objects handed out
+    int numHits;		// ... of which came from the free list
+    int numSlabs;		// # of slabs carved up
+    int numInUse;		// # of objects handed out, not yet freed
+    int maxInUse;		// the most there have ever been
+};
+
+// Allocate "size" bytes from "*pool", making the pool (named "name",
+// or "name<type>" given the type_info name of a template parameter)
+// first if this host thread doesn't have it yet.
+extern void *PoolAllocate(Pool **pool, char *name, int size,
+						const char *typeName = NULL);
+
+// Put "object" (which may be NULL) back in "pool".
+extern void PoolFree(Pool *pool, void *object);
+
+// Print the statistics of every pool of this host thread.
+extern void PrintPools();
+
+#endif // POOL_H
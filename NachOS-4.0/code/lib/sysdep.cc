@@ -29,10 +29,14 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <sys/resource.h>
 #include <sys/file.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <cerrno>
+#ifndef DOS
+#include <sys/mman.h>
+#endif
 
 #ifdef SOLARIS
 // KMS
@@ -149,6 +153,22 @@ UDelay(unsigned int useconds)
 
 }
 
+//----------------------------------------------------------------------
+// CPUSeconds
+// 	Return the user plus system CPU time used by the UNIX process
+//	running Nachos so far, in seconds.
+//----------------------------------------------------------------------
+
+double
+CPUSeconds()
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+	+ (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+}
+
 //----------------------------------------------------------------------
 // Abort
 // 	Quit and drop core.
@@ -247,6 +267,62 @@ DeallocBoundedArray(char *ptr, int size)
 }
 #endif
 
+//----------------------------------------------------------------------
+// HostPageSize
+// 	Return the size of a page of the host's memory, in bytes.
+//----------------------------------------------------------------------
+
+int
+HostPageSize()
+{
+    return getpagesize();
+}
+
+//----------------------------------------------------------------------
+// AllocPages
+// 	Return "numPages" pages of fresh, zeroed, page-aligned memory.
+//	Unlike AllocBoundedArray, this maps the pages straight from the
+//	host OS, so they take up no real memory until they are used.
+//	They are never given back.
+//
+//	"numPages" -- how many host pages are needed
+//----------------------------------------------------------------------
+
+char *
+AllocPages(int numPages)
+{
+    int size = numPages * getpagesize();
+#ifdef DOS
+    char *ptr = new char[size + getpagesize()];
+
+    ptr += getpagesize() - ((unsigned long) ptr % getpagesize());
+    bzero(ptr, size);
+    return ptr;
+#else
+    char *ptr = (char *) mmap(NULL, size, PROT_READ | PROT_WRITE,
+    					MAP_PRIVATE | MAP_ANON, -1, 0);
+
+    ASSERT(ptr != (char *) MAP_FAILED);
+    return ptr;
+#endif
+}
+
+//----------------------------------------------------------------------
+// GuardPage
+// 	Make a page that came from AllocPages inaccessible, so that any
+//	reference to it causes an error.  (Not possible on DOS.)
+//
+//	"page" -- the start of the page
+//----------------------------------------------------------------------
+
+void
+GuardPage(char *page)
+{
+#ifndef DOS
+    mprotect(page, getpagesize(), PROT_NONE);
+#endif
+}
+
 //----------------------------------------------------------------------
 // PollFile
 // 	Check open file or open socket to see if there are any 
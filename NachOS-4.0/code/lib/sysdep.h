@@ -25,6 +25,10 @@ extern void Exit(int exitCode);
 extern void Delay(int seconds);
 extern void UDelay(unsigned int usec);// rcgood - to avoid spinners.
 
+// How much CPU time the UNIX process has used, in seconds; for
+// timing benchmarks
+extern double CPUSeconds();
+
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(void (*cleanup)(int));
 
@@ -37,6 +41,13 @@ extern unsigned int RandomNumber();
 extern char *AllocBoundedArray(int size);
 extern void DeallocBoundedArray(char *p, int size);
 
+// Allocate whole pages of the host's memory (only given real memory
+// when first touched), and make a page inaccessible, so that running
+// off the end of a thread's stack into it causes an error
+extern int HostPageSize();
+extern char *AllocPages(int numPages);
+extern void GuardPage(char *page);
+
 // Check file to see if there are any characters to be read.
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
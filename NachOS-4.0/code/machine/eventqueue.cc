@@ -0,0 +1,562 @@
+// eventqueue.cc
+//	Routines to keep the pending interrupts in order of when they
+//	are due: a sorted list, a binary heap, and a hierarchical timing
+//	wheel (see eventqueue.h), and a benchmark to compare them.
+
+#include "eventqueue.h"
+#include "interrupt.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// EventBefore
+// 	Return TRUE if "x" is due before "y", or at the same time but
+//	was scheduled first.  Sequence numbers wrap around, so compare
+//	their difference.
+//----------------------------------------------------------------------
+
+bool
+EventBefore(PendingInterrupt *x, PendingInterrupt *y)
+{
+    if (x->when != y->when)
+	return (x->when < y->when);
+    return ((int) (x->seq - y->seq) < 0);
+}
+
+//----------------------------------------------------------------------
+// NewEventQueue
+// 	Return a new, empty event queue of the kind "type".
+//----------------------------------------------------------------------
+
+EventQueue *
+NewEventQueue(EventQueueType type)
+{
+    switch (type) {
+      case ListQueue:
+	return new ListEventQueue;
+      case HeapQueue:
+	return new HeapEventQueue;
+      case WheelQueue:
+	return new WheelEventQueue;
+    }
+    ASSERTNOTREACHED();
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// ListEventQueue
+// 	A sorted list of events, as Nachos has always kept them.
+//----------------------------------------------------------------------
+
+static int
+EventCompare(PendingInterrupt *x, PendingInterrupt *y)
+{
+    return EventBefore(x, y) ? -1 : 1;
+}
+
+ListEventQueue::ListEventQueue()
+{
+    list = new SortedList<PendingInterrupt *>(EventCompare);
+    numInQueue = 0;
+}
+
+ListEventQueue::~ListEventQueue()
+{
+    delete list;
+}
+
+void
+ListEventQueue::Insert(PendingInterrupt *event)
+{
+    list->Insert(event);
+    numInQueue++;
+}
+
+PendingInterrupt *
+ListEventQueue::Front()
+{
+    return (numInQueue == 0) ? NULL : list->Front();
+}
+
+PendingInterrupt *
+ListEventQueue::RemoveFront()
+{
+    if (numInQueue == 0)
+	return NULL;
+    numInQueue--;
+    return list->RemoveFront();
+}
+
+void
+ListEventQueue::Contents(PendingInterrupt **events)
+{
+    ListIterator<PendingInterrupt *> iter(list);
+
+    for (; !iter.IsDone(); iter.Next())
+	*events++ = iter.Item();
+}
+
+//----------------------------------------------------------------------
+// HeapEventQueue
+// 	A binary heap of events, in an array that doubles in size
+//	whenever it fills up.
+//----------------------------------------------------------------------
+
+HeapEventQueue::HeapEventQueue()
+{
+    size = 16;
+    heap = new PendingInterrupt *[size];
+    numInQueue = 0;
+}
+
+HeapEventQueue::~HeapEventQueue()
+{
+    delete [] heap;
+}
+
+//----------------------------------------------------------------------
+// HeapEventQueue::Insert
+// 	Put "event" at the bottom of the heap, and move it up past any
+//	event due after it.
+//----------------------------------------------------------------------
+
+void
+HeapEventQueue::Insert(PendingInterrupt *event)
+{
+    int i, parent;
+
+    if (numInQueue == size) {
+	PendingInterrupt **bigger = new PendingInterrupt *[size * 2];
+
+	bcopy(heap, bigger, size * sizeof(PendingInterrupt *));
+	delete [] heap;
+	heap = bigger;
+	size *= 2;
+    }
+    for (i = numInQueue++; i > 0; i = parent) {
+	parent = (i - 1) / 2;
+	if (!EventBefore(event, heap[parent]))
+	    break;
+	heap[i] = heap[parent];
+    }
+    heap[i] = event;
+}
+
+PendingInterrupt *
+HeapEventQueue::Front()
+{
+    return (numInQueue == 0) ? NULL : heap[0];
+}
+
+//----------------------------------------------------------------------
+// HeapEventQueue::RemoveFront
+// 	Take the event off the top of the heap, and fill the hole with
+//	the event at the bottom, moved down past any event due before it.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+HeapEventQueue::RemoveFront()
+{
+    PendingInterrupt *first, *last;
+    int i, child;
+
+    if (numInQueue == 0)
+	return NULL;
+    first = heap[0];
+    last = heap[--numInQueue];
+    for (i = 0; (child = 2 * i + 1) < numInQueue; i = child) {
+	if ((child + 1 < numInQueue) && EventBefore(heap[child + 1], heap[child]))
+	    child++;
+	if (!EventBefore(heap[child], last))
+	    break;
+	heap[i] = heap[child];
+    }
+    heap[i] = last;
+    return first;
+}
+
+void
+HeapEventQueue::Contents(PendingInterrupt **events)
+{
+    bcopy(heap, events, numInQueue * sizeof(PendingInterrupt *));
+}
+
+//----------------------------------------------------------------------
+// WheelEventQueue::WheelEventQueue
+// 	Initialize an empty timing wheel, starting at time 0.
+//----------------------------------------------------------------------
+
+WheelEventQueue::WheelEventQueue()
+{
+    Clear();
+    numInQueue = 0;
+    current = 0;
+    front = NULL;
+}
+
+//----------------------------------------------------------------------
+// WheelEventQueue::Clear
+// 	Empty every slot (forgetting whatever events were in them).
+//----------------------------------------------------------------------
+
+void
+WheelEventQueue::Clear()
+{
+    for (int level = 0; level < WheelLevels; level++) {
+	for (int i = 0; i < WheelSlots; i++) {
+	    slots[level][i].first = NULL;
+	    slots[level][i].last = NULL;
+	}
+	for (int i = 0; i < WheelSlots / 32; i++)
+	    occupied[level][i] = 0;
+	numInLevel[level] = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// WheelEventQueue::NextOccupied
+// 	Return the first slot of "level", from slot "i" on, that has any
+//	events in it, or -1 if there is none.
+//----------------------------------------------------------------------
+
+int
+WheelEventQueue::NextOccupied(int level, int i)
+{
+    int word = i / 32;
+    unsigned int bits;
+
+    if (i >= WheelSlots)
+	return -1;
+    bits = occupied[level][word] & (~0u << (i % 32));
+    while (bits == 0) {
+	if (++word == WheelSlots / 32)
+	    return -1;
+	bits = occupied[level][word];
+    }
+    for (i = word * 32; !(bits & 1); i++)
+	bits >>= 1;
+    return i;
+}
+
+//----------------------------------------------------------------------
+// WheelEventQueue::SlotFor
+// 	Return the slot where "event" belongs, and its level: the lowest
+//	level whose range (around "current") takes in the event's time.
+//----------------------------------------------------------------------
+
+WheelEventQueue::Slot *
+WheelEventQueue::SlotFor(PendingInterrupt *event, int *level)
+{
+    unsigned int when = event->when;
+    unsigned int differ = when ^ current;
+    int l = 0;
+
+    while ((l < WheelLevels - 1) && (differ >= (unsigned int) WheelSlots)) {
+	differ >>= WheelSlotBits;
+	l++;
+    }
+    *level = l;
+    return &slots[l][(when >> (l * WheelSlotBits)) & (WheelSlots - 1)];
+}
+
+// Set or clear the bit for a slot in the "occupied" bitmap.
+#define SLOT_INDEX(level, slot)	((slot) - &slots[level][0])
+#define MARK_SLOT(level, slot) \
+    (occupied[level][SLOT_INDEX(level, slot) / 32] |= \
+    			(1u << (SLOT_INDEX(level, slot) % 32)))
+#define CLEAR_SLOT(level, slot) \
+    (occupied[level][SLOT_INDEX(level, slot) / 32] &= \
+    			~(1u << (SLOT_INDEX(level, slot) % 32)))
+
+//----------------------------------------------------------------------
+// WheelEventQueue::Place
+// 	Link "event" into its slot.  The events in a slot of level 0
+//	are all due at once, so they are kept in sequence order (which
+//	is nearly always just a matter of adding to the end); the
+//	other slots are in no particular order.
+//----------------------------------------------------------------------
+
+void
+WheelEventQueue::Place(PendingInterrupt *event)
+{
+    int level;
+    Slot *slot = SlotFor(event, &level);
+    PendingInterrupt *after = slot->last;
+
+    if (level == 0) {
+	while ((after != NULL) && EventBefore(event, after))
+	    after = after->prev;
+    }
+    event->prev = after;
+    if (after == NULL) {
+	event->next = slot->first;
+	slot->first = event;
+    } else {
+	event->next = after->next;
+	after->next = event;
+    }
+    if (event->next == NULL)
+	slot->last = event;
+    else
+	event->next->prev = event;
+    MARK_SLOT(level, slot);
+    numInLevel[level]++;
+}
+
+//----------------------------------------------------------------------
+// WheelEventQueue::Unlink
+// 	Take "event" out of the slot it is in.
+//----------------------------------------------------------------------
+
+void
+WheelEventQueue::Unlink(PendingInterrupt *event)
+{
+    int level;
+    Slot *slot = SlotFor(event, &level);
+
+    if (event->prev == NULL)
+	slot->first = event->next;
+    else
+	event->prev->next = event->next;
+    if (event->next == NULL)
+	slot->last = event->prev;
+    else
+	event->next->prev = event->prev;
+    if (slot->first == NULL)
+	CLEAR_SLOT(level, slot);
+    numInLevel[level]--;
+}
+
+//----------------------------------------------------------------------
+// WheelEventQueue::Advance
+// 	Move "current" forward to "when", which is no later than any
+//	event in the wheel.  On each level that "current" moves into a
+//	new slot of, the events in that slot now belong on lower levels;
+//	redistribute them, starting from the top.
+//----------------------------------------------------------------------
+
+void
+WheelEventQueue::Advance(unsigned int when)
+{
+    unsigned int old = current;
+
+    current = when;
+    for (int level = WheelLevels - 1; level > 0; level--) {
+	int shift = level * WheelSlotBits;
+
+	if ((old >> shift) != (when >> shift)) {
+	    Slot *slot = &slots[level][(when >> shift) & (WheelSlots - 1)];
+	    PendingInterrupt *event = slot->first, *next;
+
+	    slot->first = NULL;
+	    slot->last = NULL;
+	    CLEAR_SLOT(level, slot);
+	    for (; event != NULL; event = next) {
+		next = event->next;
+		numInLevel[level]--;
+		Place(event);
+	    }
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// WheelEventQueue::Rebase
+// 	Move "current" back to "when", to make room for an event due
+//	before it; every event has to be placed again.  The interrupt
+//	simulation never schedules anything in the past, so this only
+//	happens when the pending interrupts are retimed wholesale (as in
+//	restoring a snapshot).
+//----------------------------------------------------------------------
+
+void
+WheelEventQueue::Rebase(unsigned int when)
+{
+    PendingInterrupt **events = new PendingInterrupt *[numInQueue];
+    int i;
+
+    Contents(events);
+    Clear();
+    current = when;
+    front = NULL;
+    for (i = 0; i < numInQueue; i++)
+	Place(events[i]);
+    delete [] events;
+}
+
+//----------------------------------------------------------------------
+// WheelEventQueue::Insert
+// 	Put "event" in its slot.
+//----------------------------------------------------------------------
+
+void
+WheelEventQueue::Insert(PendingInterrupt *event)
+{
+    if ((unsigned int) event->when < current)
+	Rebase(event->when);
+    Place(event);
+    numInQueue++;
+    if ((front != NULL) && EventBefore(event, front))
+	front = event;
+}
+
+//----------------------------------------------------------------------
+// WheelEventQueue::Front
+// 	Return the earliest event: the first one in the first occupied
+//	slot after "current" on the lowest occupied level.  Remembered
+//	until it is removed, or something earlier is inserted.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+WheelEventQueue::Front()
+{
+    if ((front != NULL) || (numInQueue == 0))
+	return front;
+
+    for (int level = 0; level < WheelLevels; level++) {
+	int shift = level * WheelSlotBits;
+	int i = (current >> shift) & (WheelSlots - 1);
+	PendingInterrupt *event;
+
+	if (numInLevel[level] == 0)
+	    continue;
+	if (level > 0)		// events in the slot of "current" are
+	    i++;		// on a lower level
+	i = NextOccupied(level, i);
+	ASSERT(i >= 0);		// no event is due before "current"
+
+	event = slots[level][i].first;
+	front = event;
+	if (level > 0) {	// slot is not in order
+	    for (event = event->next; event != NULL; event = event->next) {
+		if (EventBefore(event, front))
+		    front = event;
+	    }
+	}
+	return front;
+    }
+    ASSERTNOTREACHED();
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// WheelEventQueue::RemoveFront
+// 	Take out the earliest event, and move the wheel up to its time.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+WheelEventQueue::RemoveFront()
+{
+    PendingInterrupt *event = Front();
+
+    if (event == NULL)
+	return NULL;
+    Unlink(event);
+    numInQueue--;
+    front = NULL;
+    Advance(event->when);
+    return event;
+}
+
+void
+WheelEventQueue::Contents(PendingInterrupt **events)
+{
+    for (int level = 0; level < WheelLevels; level++) {
+	for (int i = 0; i < WheelSlots; i++) {
+	    PendingInterrupt *event = slots[level][i].first;
+
+	    for (; event != NULL; event = event->next)
+		*events++ = event;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// EventQueueBenchmark
+// 	Time each kind of event queue on the "hold" model: with a fixed
+//	number of events pending, repeatedly take out the earliest and
+//	schedule a new one some (random) time after it -- as the devices
+//	and the timer do.  Most new events are due soon, a few much
+//	later, and many fall due at the same time as another.
+//
+//	Every queue must fire the events in the same order; a checksum
+//	of the order is compared to catch any that don't.
+//----------------------------------------------------------------------
+
+static const int BenchHolds = 2000000;		// events fired per run
+static const int BenchDelays = 4096;		// # of random delays to use
+
+void
+EventQueueBenchmark()
+{
+    static const int pendingSizes[] = { 4, 64, 1024, 16384 };
+    static const char *queueNames[] = { "list", "heap", "wheel" };
+    int *delays = new int[BenchDelays];
+    int numSizes = sizeof(pendingSizes) / sizeof(int);
+    bool agree = TRUE;
+    char line[80];
+
+    for (int i = 0; i < BenchDelays; i++) {
+	unsigned int r = RandomNumber();
+	delays[i] = (r % 8 == 0) ? (r >> 3) % 10000 + 1 : (r >> 3) % 100 + 1;
+    }
+
+    cout << "Event queue benchmark: " << BenchHolds << " events per run\n";
+    cout << "queue   pending    seconds  Mevents/s\n";
+    for (int s = 0; s < numSizes; s++) {
+	int numPending = pendingSizes[s];
+	unsigned int checksum[3];
+	int listHolds = BenchHolds;
+
+	for (int type = ListQueue; type <= WheelQueue; type++) {
+	    EventQueue *queue = NewEventQueue((EventQueueType) type);
+	    PendingInterrupt **events = new PendingInterrupt *[numPending];
+	    unsigned int seq = 0, sum = 0;
+	    int holds = BenchHolds;
+	    double start, seconds;
+
+	    if ((type == ListQueue) && (numPending >= 1024)) {
+		holds = BenchHolds / 100;	// too slow otherwise
+		listHolds = holds;
+	    }
+	    for (int i = 0; i < numPending; i++) {
+		events[i] = new PendingInterrupt(NULL,
+			delays[i % BenchDelays], TimerInt, AnyCPU);
+		events[i]->seq = seq++;
+		queue->Insert(events[i]);
+	    }
+	    start = CPUSeconds();
+	    for (int i = 0; i < holds; i++) {
+		PendingInterrupt *event = queue->RemoveFront();
+
+		sum = sum * 31 + event->seq;
+		event->when += delays[i % BenchDelays];
+		event->seq = seq++;
+		queue->Insert(event);
+	    }
+	    seconds = CPUSeconds() - start;
+	    sprintf(line, "%-6s %8d %10.3f %10.3f\n", queueNames[type],
+		numPending, seconds, holds / (seconds * 1000000.0 + 1e-9));
+	    cout << line;
+
+	    checksum[type] = sum;
+	    if ((type != ListQueue) && (listHolds == holds)
+				&& (checksum[type] != checksum[ListQueue])) {
+		cout << "  " << queueNames[type] << " fired events in a "
+				"different order from the list!\n";
+		agree = FALSE;
+	    }
+	    for (int i = 0; i < numPending; i++)
+		delete events[i];
+	    delete [] events;
+	    delete queue;
+	}
+	if (listHolds != BenchHolds) {		// check the heap and wheel
+	    if (checksum[HeapQueue] != checksum[WheelQueue]) {
+		cout << "  heap and wheel fired events in different orders!\n";
+		agree = FALSE;
+	    }
+	}
+    }
+    cout << (agree ? "All queues agree\n" : "Queues DISAGREE\n");
+    delete [] delays;
+}
@@ -0,0 +1,156 @@
+// eventqueue.h
+//	Data structures for keeping track of the interrupts scheduled to
+//	happen in the future, in order of when they are due.
+//
+//	The interrupt simulation asks for the earliest interrupt after
+//	nearly every user instruction, and the devices and the timer
+//	schedule a new one each time one fires, so how the pending
+//	interrupts are kept matters to how fast Nachos runs.  There are
+//	three interchangeable implementations (picked with -eq):
+//
+//	  ListEventQueue -- the original sorted list; O(n) to insert.
+//	  HeapEventQueue -- a binary heap in an array; O(log n) to
+//		insert or remove, no allocation once the array is big enough.
+//	  WheelEventQueue -- a hierarchical timing wheel (four levels of
+//		256 slots, covering ever coarser ranges of time); O(1) to
+//		insert, and close to O(1) to remove, as long as time only
+//		moves forward.
+//
+//	Interrupts due at the same time come out in the order they were
+//	scheduled (first in, first out), whichever queue is used: each
+//	is stamped with a sequence number when it is scheduled.
+//
+//	The heap and the wheel link interrupts through the PendingInterrupt
+//	itself, so scheduling an interrupt allocates nothing but the
+//	PendingInterrupt (which comes from a pool; see pool.h).
+
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+#include "list.h"
+
+class PendingInterrupt;
+
+// The kinds of event queue.
+enum EventQueueType { ListQueue, HeapQueue, WheelQueue };
+
+// The following class defines the operations on a queue of pending
+// interrupts, ordered by when they are due (and then by sequence
+// number).
+
+class EventQueue {
+  public:
+    virtual ~EventQueue() {}
+
+    virtual void Insert(PendingInterrupt *event) = 0;
+				// Add an event to the queue
+    virtual PendingInterrupt *Front() = 0;
+				// The earliest event, or NULL if empty
+    virtual PendingInterrupt *RemoveFront() = 0;
+				// Remove and return the earliest event
+    virtual void Contents(PendingInterrupt **events) = 0;
+				// Copy every event in the queue, in no
+				// particular order, into "events"
+
+    int NumInQueue() { return numInQueue; }
+    bool IsEmpty() { return (numInQueue == 0); }
+
+  protected:
+    int numInQueue;		// # of events in the queue
+};
+
+// Make a new, empty event queue of the given kind.
+extern EventQueue *NewEventQueue(EventQueueType type);
+
+// Return TRUE if event "x" should fire before event "y".
+extern bool EventBefore(PendingInterrupt *x, PendingInterrupt *y);
+
+// The original implementation: a sorted list.
+
+class ListEventQueue : public EventQueue {
+  public:
+    ListEventQueue();
+    ~ListEventQueue();
+
+    void Insert(PendingInterrupt *event);
+    PendingInterrupt *Front();
+    PendingInterrupt *RemoveFront();
+    void Contents(PendingInterrupt **events);
+
+  private:
+    SortedList<PendingInterrupt *> *list;
+};
+
+// A binary heap: the earliest event is heap[0], and each event fires
+// no later than the two below it, heap[2i + 1] and heap[2i + 2].
+
+class HeapEventQueue : public EventQueue {
+  public:
+    HeapEventQueue();
+    ~HeapEventQueue();
+
+    void Insert(PendingInterrupt *event);
+    PendingInterrupt *Front();
+    PendingInterrupt *RemoveFront();
+    void Contents(PendingInterrupt **events);
+
+  private:
+    PendingInterrupt **heap;	// the events
+    int size;			// how many the array has room for
+};
+
+// A hierarchical timing wheel.  Each event is kept in the lowest
+// level whose range covers it: level L holds the events that agree
+// with "current" on all but the low 8(L + 1) bits of "when", in slot
+// (when >> 8L) & 255.  So all the events in a slot of level 0 are due
+// at the same time, and the events of level L all come before those
+// of level L + 1.  When "current" moves on, the events in the slots
+// it moves into are spread over the lower levels ("cascading").
+
+const int WheelLevels = 4;
+const int WheelSlotBits = 8;
+const int WheelSlots = 1 << WheelSlotBits;
+
+class WheelEventQueue : public EventQueue {
+  public:
+    WheelEventQueue();
+    ~WheelEventQueue() {}
+
+    void Insert(PendingInterrupt *event);
+    PendingInterrupt *Front();
+    PendingInterrupt *RemoveFront();
+    void Contents(PendingInterrupt **events);
+
+  private:
+    class Slot {		// a doubly linked list of events
+      public:
+	PendingInterrupt *first;
+	PendingInterrupt *last;
+    };
+
+    Slot slots[WheelLevels][WheelSlots];
+    unsigned int occupied[WheelLevels][WheelSlots / 32];
+    				// a bit for each slot with events in it
+    int numInLevel[WheelLevels];// # of events on each level
+    unsigned int current;	// no event is due before this time
+    PendingInterrupt *front;	// the earliest event, if known, or NULL
+
+    Slot *SlotFor(PendingInterrupt *event, int *level);
+    				// Where "event" belongs, relative to "current"
+    void Place(PendingInterrupt *event);
+    				// Put "event" in its slot
+    void Unlink(PendingInterrupt *event);
+    				// Take "event" out of its slot
+    int NextOccupied(int level, int i);
+    				// The first slot from "i" on with events
+    void Clear();		// Empty every slot
+    void Advance(unsigned int when);
+    				// Move "current" forward to "when"
+    void Rebase(unsigned int when);
+    				// Move "current" back to "when"
+};
+
+// Time the queues against each other, and check that they agree.
+extern void EventQueueBenchmark();
+
+#endif // EVENTQUEUE_H
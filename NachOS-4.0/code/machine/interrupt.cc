@@ -23,13 +23,16 @@
 #include "copyright.h"
 #include "interrupt.h"
 #include "main.h"
+#include "stackpool.h"
 
 // String definitions for debugging messages
 
 static char *intLevelNames[] = { "off", "on"};
 static char *intTypeNames[] = { "timer", "disk", "console write", 
 			"console read", "network send", 
-			"network recv"};
+			"network recv", "snapshot"};
+
+__thread Pool *PendingInterrupt::pool = NULL;
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -39,27 +42,18 @@ static char *intTypeNames[] = { "timer", "disk", "console write",
 //	"callOnInt" is the object to call when the interrupt occurs
 //	"time" is when (in simulated time) the interrupt is to occur
 //	"kind" is the hardware device that generated the interrupt
+//	"target" is the CPU to interrupt, or AnyCPU
 //----------------------------------------------------------------------
 
 PendingInterrupt::PendingInterrupt(CallBackObj *callOnInt, 
-					int time, IntType kind)
+					int time, IntType kind, int target)
 {
     callOnInterrupt = callOnInt;
     when = time;
     type = kind;
-}
-
-//----------------------------------------------------------------------
-// PendingCompare
-//	Compare to interrupts based on which should occur first.
-//----------------------------------------------------------------------
-
-static int
-PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
-{
-    if (x->when < y->when) { return -1; }
-    else if (x->when > y->when) { return 1; }
-    else { return 0; }
+    cpu = target;
+    seq = 0;
+    next = prev = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -67,12 +61,19 @@ PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
 // 	Initialize the simulation of hardware device interrupts.
 //	
 //	Interrupts start disabled, with no interrupts pending, etc.
+//
+//	"queueType" is how to keep the pending interrupts in order
+//	"numCPUs" is the number of CPUs to be interrupted
 //----------------------------------------------------------------------
 
-Interrupt::Interrupt()
+Interrupt::Interrupt(EventQueueType queueType, int numCPUs)
 {
     level = IntOff;
-    pending = new SortedList<PendingInterrupt *>(PendingCompare);
+    numQueues = (numCPUs > 1) ? numCPUs + 1 : 1;
+    pending = new EventQueue *[numQueues];
+    for (int i = 0; i < numQueues; i++)
+	pending[i] = NewEventQueue(queueType);
+    nextSeq = 0;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -85,10 +86,13 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty()) {
-	delete pending->RemoveFront();
+    for (int i = 0; i < numQueues; i++) {
+	while (!pending[i]->IsEmpty()) {
+	    delete pending[i]->RemoveFront();
+	}
+	delete pending[i];
     }
-    delete pending;
+    delete [] pending;
 }
 
 //----------------------------------------------------------------------
@@ -147,17 +151,62 @@ Interrupt::SetLevel(IntStatus now)
 void
 Interrupt::OneTick()
 {
-    MachineStatus oldStatus = status;
+    MultiTick(1);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::AddTicks
+// 	Advance simulated time by "count" ticks of the current mode,
+//	without checking for pending interrupts.  The caller must know
+//	that none can come due (see Machine::InstructionsUntilDue).
+//	The ticks are charged to the current thread as well.
+//----------------------------------------------------------------------
+void
+Interrupt::AddTicks(int count)
+{
     Statistics *stats = kernel->stats;
+    Thread *thread = kernel->currentThread;
 
-// advance simulated time
     if (status == SystemMode) {
-        stats->totalTicks += SystemTick;
-	stats->systemTicks += SystemTick;
+        stats->totalTicks += count * SystemTick;
+	stats->systemTicks += count * SystemTick;
+	thread->systemTicks += count * SystemTick;
     } else {
-	stats->totalTicks += UserTick;
-	stats->userTicks += UserTick;
+	stats->totalTicks += count * UserTick;
+	stats->userTicks += count * UserTick;
+	thread->userTicks += count * UserTick;
     }
+}
+
+//----------------------------------------------------------------------
+// Interrupt::NextDueTick
+// 	Return the time at which the earliest pending interrupt is
+//	scheduled to fire, or -1 if nothing is pending.  Nothing can be
+//	scheduled before that time without the kernel running, so the
+//	CPU simulation can run user code until then without checking.
+//----------------------------------------------------------------------
+int
+Interrupt::NextDueTick()
+{
+    PendingInterrupt *next = NextFor(AnyCPU);
+
+    return (next == NULL) ? -1 : next->when;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::MultiTick
+// 	Like OneTick, but advance simulated time by "count" ticks before
+//	checking for pending interrupts.  Used when a run of user
+//	instructions is charged at once (see BlockEngine::Run); any
+//	interrupt that came due during the run fires at its end.
+//----------------------------------------------------------------------
+void
+Interrupt::MultiTick(int count)
+{
+    MachineStatus oldStatus = status;
+    Statistics *stats = kernel->stats;
+
+    AddTicks(count);		// advance simulated time
     DEBUG(dbgInt, "== Tick " << stats->totalTicks << " ==");
 
 // check any pending interrupts are now ready to fire
@@ -175,6 +224,38 @@ Interrupt::OneTick()
     }
 }
 
+//----------------------------------------------------------------------
+// Interrupt::NextCPU
+// 	Called by Machine::Run after each user instruction, when there
+//	is more than one CPU, to hand the simulation to the next CPU
+//	that has a thread (or can be given one; see Scheduler::NextCPU).
+//
+//	The CPUs run in lock step: simulated time advances by one user
+//	tick once every busy CPU has had its turn, and each CPU takes
+//	the interrupts that are due for it at the start of its turn.
+//
+//	Kernel code is never interleaved this way, so it runs on one
+//	CPU at a time, as if under a single big kernel lock.
+//----------------------------------------------------------------------
+void
+Interrupt::NextCPU()
+{
+    int cpu = kernel->machine->CurrentCPU();
+    int next;
+
+    ChangeLevel(IntOn, IntOff);		// the scheduler needs interrupts off
+    next = kernel->scheduler->NextCPU();
+    if (next <= cpu)			// every busy CPU has had its turn
+	AddTicks(1);
+    if (next != cpu) {
+	status = SystemMode;
+	kernel->scheduler->SwitchToCPU(next);
+	status = UserMode;		// now the thread on some other CPU
+    }
+    ChangeLevel(IntOff, IntOn);
+    MultiTick(0);			// take this CPU's interrupts
+}
+
 //----------------------------------------------------------------------
 // Interrupt::YieldOnReturn
 // 	Called from within an interrupt handler, to cause a context switch
@@ -235,6 +316,15 @@ Interrupt::Halt()
 {
     cout << "Machine halting!\n\n";
     kernel->stats->Print();
+    if (kernel->machine->NumCPUs() > 1)
+	kernel->machine->PrintCPUStats();
+    kernel->machine->PrintProfile();
+    if (debug->IsEnabled(dbgPool)) {
+	PrintPools();
+	PrintStackPools();
+    }
+    if (debug->IsEnabled(dbgPaging))
+	kernel->procmgr->printPaging();
     delete kernel;	// Never returns.
 }
 
@@ -243,7 +333,7 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: put it on an event queue (see eventqueue.h).
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -252,17 +342,19 @@ Interrupt::Halt()
 //	"fromNow" is how far in the future (in simulated time) the 
 //		 interrupt is to occur
 //	"type" is the hardware device that generated the interrupt
+//	"cpu" is the CPU to interrupt; by default, the first to notice
 //----------------------------------------------------------------------
 void
-Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type)
+Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type, int cpu)
 {
     int when = kernel->stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(toCall, when, type);
+    PendingInterrupt *toOccur = new PendingInterrupt(toCall, when, type, cpu);
 
     DEBUG(dbgInt, "Scheduling interrupt handler the " << intTypeNames[type] << " at time = " << when);
     ASSERT(fromNow > 0);
 
-    pending->Insert(toOccur);
+    toOccur->seq = nextSeq++;
+    QueueFor(cpu)->Insert(toOccur);
 }
 
 //----------------------------------------------------------------------
@@ -270,6 +362,10 @@ Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type)
 // 	Check if any interrupts are scheduled to occur, and if so, 
 //	fire them off.
 //
+//	Only the interrupts for the current CPU are considered, unless
+//	every CPU is idle, in which case it doesn't matter which one
+//	takes them.
+//
 // Returns:
 //	TRUE, if we fired off any interrupt handlers
 // Params:
@@ -282,16 +378,19 @@ Interrupt::CheckIfDue(bool advanceClock)
 {
     PendingInterrupt *next;
     Statistics *stats = kernel->stats;
+    int cpu = AnyCPU;
 
     ASSERT(level == IntOff);		// interrupts need to be disabled,
 					// to invoke an interrupt handler
     if (debug->IsEnabled(dbgInt)) {
 	DumpState();
     }
-    if (pending->IsEmpty()) {   	// no pending interrupts
-	return FALSE;	
-    }		
-    next = pending->Front();
+    if (!advanceClock && (kernel->machine != NULL)) {
+	cpu = kernel->machine->CurrentCPU();
+    }
+    if ((next = NextFor(cpu)) == NULL) {
+	return FALSE;
+    }
     if (next->when > stats->totalTicks) {
         if (!advanceClock) {		// not time yet
             return FALSE;
@@ -312,15 +411,190 @@ Interrupt::CheckIfDue(bool advanceClock)
 
     inHandler = TRUE;
     do {
-        next = pending->RemoveFront();    // pull interrupt off list
+        QueueFor(next->cpu)->RemoveFront(); // pull interrupt off queue
         next->callOnInterrupt->CallBack();// call the interrupt handler
 	delete next;
-    } while (!pending->IsEmpty() 
-    		&& (pending->Front()->when <= stats->totalTicks));
+    } while (((next = NextFor(cpu)) != NULL)
+    		&& (next->when <= stats->totalTicks));
     inHandler = FALSE;
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Interrupt::NextFor
+// 	Return the earliest pending interrupt that "cpu" can take, or
+//	NULL if there is none: the earlier of the first interrupt for
+//	any CPU and the first for "cpu" itself (or, if "cpu" is AnyCPU,
+//	the earliest of all).
+//----------------------------------------------------------------------
+PendingInterrupt *
+Interrupt::NextFor(int cpu)
+{
+    PendingInterrupt *next = pending[0]->Front();
+    PendingInterrupt *other;
+
+    for (int i = 1; i < numQueues; i++) {
+	if ((cpu == AnyCPU) || (cpu == i - 1)) {
+	    other = pending[i]->Front();
+	    if ((other != NULL) && ((next == NULL) || EventBefore(other, next)))
+		next = other;
+	}
+    }
+    return next;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::QueueFor
+// 	Return the queue for interrupts directed at "cpu".  With one
+//	CPU, there is only one queue.
+//----------------------------------------------------------------------
+EventQueue *
+Interrupt::QueueFor(int cpu)
+{
+    if ((cpu == AnyCPU) || (numQueues == 1))
+	return pending[0];
+    return pending[cpu + 1];
+}
+
+//----------------------------------------------------------------------
+// Interrupt::AllPending
+// 	Return a new array of all the pending interrupts, in the order
+//	they will fire (as far as the CPUs are concerned), and put the
+//	number of them in "count".  Only used where speed doesn't matter.
+//----------------------------------------------------------------------
+static int
+CompareEvents(const void *x, const void *y)
+{
+    return EventBefore(*(PendingInterrupt **) x, *(PendingInterrupt **) y)
+    								? -1 : 1;
+}
+
+PendingInterrupt **
+Interrupt::AllPending(int *count)
+{
+    PendingInterrupt **all;
+    int n = 0;
+
+    for (int i = 0; i < numQueues; i++)
+	n += pending[i]->NumInQueue();
+    all = new PendingInterrupt *[n + 1];
+    n = 0;
+    for (int i = 0; i < numQueues; i++) {
+	pending[i]->Contents(all + n);
+	n += pending[i]->NumInQueue();
+    }
+    qsort(all, n, sizeof(PendingInterrupt *), CompareEvents);
+    *count = n;
+    return all;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::DevicesIdle
+// 	Return TRUE if no device has an operation in progress, so that
+//	a freshly booted machine has the same kinds of interrupts pending
+//	(just the timer, and the polling for console and network input).
+//	Snapshots can only be taken then.
+//----------------------------------------------------------------------
+bool
+Interrupt::DevicesIdle()
+{
+    int n;
+    PendingInterrupt **all = AllPending(&n);
+    bool idle = TRUE;
+
+    for (int i = 0; i < n; i++) {
+	switch (all[i]->type) {
+	  case TimerInt: case ConsoleReadInt: case NetworkRecvInt:
+	    break;
+	  default:
+	    idle = FALSE;
+	}
+    }
+    delete [] all;
+    return idle;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::WriteSnapshot
+// 	Write the kind, CPU and due time of each pending interrupt to the
+//	open file "fd".  The objects to call can't be saved; ReadSnapshot
+//	matches them up with those of the restored machine instead.
+//----------------------------------------------------------------------
+void
+Interrupt::WriteSnapshot(int fd)
+{
+    int n;
+    PendingInterrupt **all = AllPending(&n);
+
+    WriteFile(fd, (char *) &n, sizeof(int));
+    for (int i = 0; i < n; i++) {
+	PendingInterrupt *p = all[i];
+	int record[3];
+
+	record[0] = p->type;
+	record[1] = p->cpu;
+	record[2] = p->when;
+	WriteFile(fd, (char *) record, sizeof(record));
+    }
+    delete [] all;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::ReadSnapshot
+// 	Read back what WriteSnapshot saved, and make each interrupt now
+//	pending come due when the saved one of the same kind (and CPU)
+//	did.  The machine has just booted, so its devices are idle and
+//	their polls are pending, as they were when the snapshot was
+//	taken (see DevicesIdle).  A snapshot of this machine that has
+//	already been asked for is left alone, and so are the timers,
+//	which may or may not have been stopped in either machine (see
+//	Alarm::Tick).
+//
+//	Returns FALSE if the two sets of interrupts don't match up --
+//	for instance, if the snapshot came from a differently configured
+//	machine.
+//----------------------------------------------------------------------
+bool
+Interrupt::ReadSnapshot(int fd)
+{
+    int n, numSaved, record[3], i, j;
+    PendingInterrupt **now = AllPending(&n);
+    bool *matched = new bool[n + 1];
+    bool ok = TRUE;
+
+    for (i = 0; i < numQueues; i++) {	// take them all out, to retime
+	while (!pending[i]->IsEmpty())
+	    pending[i]->RemoveFront();
+    }
+    for (i = 0; i < n; i++)
+	matched[i] = FALSE;
+    Read(fd, (char *) &numSaved, sizeof(int));
+    for (i = 0; i < numSaved; i++) {
+	Read(fd, (char *) record, sizeof(record));
+	for (j = 0; j < n; j++) {
+	    if (!matched[j] && (now[j]->type == record[0])
+				&& (now[j]->cpu == record[1]))
+		break;
+	}
+	if (j == n) {
+	    if (record[0] != TimerInt)
+		ok = FALSE;
+	} else {
+	    matched[j] = TRUE;
+	    now[j]->when = record[2];
+	}
+    }
+    for (i = 0; i < n; i++) {
+	if (!matched[i] && (now[i]->type != SnapshotInt)
+				&& (now[i]->type != TimerInt))
+	    ok = FALSE;
+	QueueFor(now[i]->cpu)->Insert(now[i]);
+    }
+    delete [] now;
+    delete [] matched;
+    return ok;
+}
+
 //----------------------------------------------------------------------
 // PrintPending
 // 	Print information about an interrupt that is scheduled to occur.
@@ -332,6 +606,8 @@ PrintPending (PendingInterrupt *pending)
 {
     cout << "Interrupt handler "<< intTypeNames[pending->type];
     cout << ", scheduled at " << pending->when;
+    if (pending->cpu != AnyCPU)
+	cout << ", for CPU " << pending->cpu;
 }
 
 //----------------------------------------------------------------------
@@ -343,9 +619,14 @@ PrintPending (PendingInterrupt *pending)
 void
 Interrupt::DumpState()
 {
+    int n;
+    PendingInterrupt **all = AllPending(&n);
+
     cout << "Time: " << kernel->stats->totalTicks;
     cout << ", interrupts " << intLevelNames[level] << "\n";
     cout << "Pending interrupts:\n";
-    pending->Apply(PrintPending);
+    for (int i = 0; i < n; i++)
+	PrintPending(all[i]);
+    delete [] all;
     cout << "\nEnd of pending interrupts\n";
 }
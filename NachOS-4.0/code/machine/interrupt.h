@@ -35,7 +35,9 @@
 
 #include "copyright.h"
 #include "list.h"
+#include "pool.h"
 #include "callback.h"
+#include "eventqueue.h"
 
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
 enum IntStatus { IntOff, IntOn };
@@ -48,8 +50,15 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 // IntType records which hardware device generated an interrupt.
 // In Nachos, we support a hardware timer device, a disk, a console
 // display and keyboard, and a network.
+// The simulator itself can also ask for an "interrupt", to take a
+// snapshot of the machine (see snapshot.h).
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
-			NetworkSendInt, NetworkRecvInt};
+			NetworkSendInt, NetworkRecvInt, SnapshotInt};
+
+// With more than one simulated CPU, an interrupt can be directed at
+// one of them (like each CPU's own timer), or taken by whichever CPU
+// notices it first (like the devices).
+const int AnyCPU = -1;
 
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
@@ -57,7 +66,8 @@ enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt,
 
 class PendingInterrupt {
   public:
-    PendingInterrupt(CallBackObj *callOnInt, int time, IntType kind);
+    PendingInterrupt(CallBackObj *callOnInt, int time, IntType kind,
+				int cpu);
 				// initialize an interrupt that will
 				// occur in the future
 
@@ -66,6 +76,18 @@ class PendingInterrupt {
     
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    int cpu;			// the CPU to interrupt, or AnyCPU
+
+    unsigned int seq;		// order scheduled, to break ties
+    PendingInterrupt *next;	// links for the event queue (see 
+    PendingInterrupt *prev;	// eventqueue.h)
+
+    void *operator new(size_t size)	// kept in a pool, for re-use
+	{ return PoolAllocate(&pool, "PendingInterrupt", size); }
+    void operator delete(void *event) { PoolFree(pool, event); }
+
+  private:
+    static __thread Pool *pool;	// this host thread's interrupts
 };
 
 // The following class defines the data structures for the simulation
@@ -75,7 +97,8 @@ class PendingInterrupt {
 
 class Interrupt {
   public:
-    Interrupt();		// initialize the interrupt simulation
+    Interrupt(EventQueueType queueType, int numCPUs);
+    				// initialize the interrupt simulation
     ~Interrupt();		// de-allocate data structures
     
     IntStatus SetLevel(IntStatus level);
@@ -96,6 +119,8 @@ class Interrupt {
     
     void YieldOnReturn();	// cause a context switch on return 
 				// from an interrupt handler
+    bool InHandler() { return inHandler; }
+    				// are we in an interrupt handler?
 
     MachineStatus getStatus() { return status; } 
     void setStatus(MachineStatus st) { status = st; }
@@ -109,18 +134,35 @@ class Interrupt {
     // but they need to be public since they are called by the
     // hardware device simulators.
 
-    void Schedule(CallBackObj *callTo, int when, IntType type);
+    void Schedule(CallBackObj *callTo, int when, IntType type,
+				int cpu = AnyCPU);
     				// Schedule an interrupt to occur
 				// at time "when".  This is called
     				// by the hardware device simulators.
     
     void OneTick();       	// Advance simulated time
+    void MultiTick(int count);	// Advance simulated time by "count" ticks
+				// at once, then check for interrupts
+    void AddTicks(int count);	// Advance simulated time by "count" ticks,
+				// when no interrupt can come due meanwhile
+    int NextDueTick();		// When the next pending interrupt is 
+				// due, or -1 if there are none
+    void NextCPU();		// Move on to the next simulated CPU
+				// after a user instruction
+
+    bool DevicesIdle();		// TRUE if no I/O is in progress: the only
+				// interrupts pending are the timer's
+				// and the devices' polls for input
+    void WriteSnapshot(int fd);	// Save when each pending interrupt is due
+    bool ReadSnapshot(int fd);	// Reset the pending interrupts (of a
+				// freshly booted machine) to match
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    SortedList<PendingInterrupt *> *pending;		
-    				// the list of interrupts scheduled
-				// to occur in the future
+    EventQueue **pending;	// the interrupts scheduled to occur in
+    int numQueues;		// the future: one queue for any CPU,
+				// plus one for each CPU, if more than one
+    unsigned int nextSeq;	// sequence number for the next interrupt
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
@@ -131,6 +173,13 @@ class Interrupt {
     bool CheckIfDue(bool advanceClock); 
     				// Check if any interrupts are supposed
 				// to occur now, and if so, do them
+    PendingInterrupt *NextFor(int cpu);
+    				// The first pending interrupt the
+				// CPU can take, if any
+    EventQueue *QueueFor(int cpu);
+    				// The queue for interrupts to "cpu"
+    PendingInterrupt **AllPending(int *count);
+    				// Every pending interrupt, in order
 
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 			IntStatus now); // simulated time
@@ -9,6 +9,9 @@
 
 #include "copyright.h"
 #include "machine.h"
+#include "mipssim.h"
+#include "mipsblock.h"
+#include "profiler.h"
 #include "main.h"
 
 // Textual names of the exceptions that can be generated by user program
@@ -50,27 +53,71 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"translateBlocks" -- if TRUE, run user code with the basic-block
+//		translation engine (see mipsblock.h) rather than the
+//		instruction-at-a-time interpreter.
+//	"batch" -- if TRUE, charge ticks for runs of user instructions
+//		at once (see Machine::Run); if FALSE, call OneTick after
+//		every instruction.  Simulated time is the same either way.
+//	"cacheXlate" -- if TRUE, remember the last page table translation
+//		used for fetches, loads and stores (see Machine::Translate).
+//	"nCPUs" -- the number of processors sharing main memory.
+//		CPU 0 starts out loaded.
+//	"profileFile" -- if not NULL, profile user code (see profiler.h),
+//		and write the profile to this file when Nachos halts.
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, bool translateBlocks, bool batch,
+			bool cacheXlate, int nCPUs, char *profileFile)
 {
-    int i;
+    int i, cpu;
+
+    ASSERT((nCPUs >= 1) && (nCPUs <= MaxCPUs));
 
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
+    decodeCache = new Instruction[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++)
+	decodeCache[i].valid = FALSE;
+    for (i = 0; i < NumPhysPages; i++)
+	codePage[i] = FALSE;
+    numCPUs = nCPUs;
+    currentCPU = 0;
+    cpus = new CPUState[numCPUs];
+    for (cpu = 0; cpu < numCPUs; cpu++) {
+	for (i = 0; i < NumTotalRegs; i++)
+	    cpus[cpu].registers[i] = 0;
 #ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-	tlb[i].valid = FALSE;
-    pageTable = NULL;
+	cpus[cpu].tlb = new TranslationEntry[TLBSize];
+	for (i = 0; i < TLBSize; i++)
+	    cpus[cpu].tlb[i].valid = FALSE;
 #else	// use linear page table
-    tlb = NULL;
-    pageTable = NULL;
+	cpus[cpu].tlb = NULL;
 #endif
+	cpus[cpu].pageTable = NULL;
+	cpus[cpu].pageTableSize = 0;
+	cpus[cpu].numInstructions = 0;
+    }
+    tlb = cpus[0].tlb;
+    pageTable = NULL;
+    pageTableSize = 0;
+    cacheTranslations = cacheXlate;
+    FlushTranslations();
 
+    if (translateBlocks)
+	blockEngine = new BlockEngine(this);
+    else
+	blockEngine = NULL;
+    if (profileFile != NULL)
+	profiler = new Profiler(profileFile);
+    else
+	profiler = NULL;
+
+    batchTicks = batch;
+    uncharged = 0;
     singleStep = debug;
     CheckEndian();
 }
@@ -83,8 +130,143 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
-    if (tlb != NULL)
-        delete [] tlb;
+    delete [] decodeCache;
+    if (blockEngine != NULL)
+	delete blockEngine;
+    if (profiler != NULL)
+	delete profiler;
+    for (int cpu = 0; cpu < numCPUs; cpu++) {
+	if (cpus[cpu].tlb != NULL)
+	    delete [] cpus[cpu].tlb;
+    }
+    delete [] cpus;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTranslations
+// 	Discard the cached page table translations, because the page
+//	table has been switched or edited.
+//
+//	The other CPUs may be running in the same address space, so
+//	their translations go too -- the simulated equivalent of a
+//	TLB shootdown.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTranslations()
+{
+    fetchCache.Flush();
+    readCache.Flush();
+    writeCache.Flush();
+    if (numCPUs > 1) {
+	for (int cpu = 0; cpu < numCPUs; cpu++) {
+	    cpus[cpu].fetchCache.Flush();
+	    cpus[cpu].readCache.Flush();
+	    cpus[cpu].writeCache.Flush();
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::SwitchCPU
+// 	Stop simulating the current processor and start simulating
+//	"cpu": save the current CPU's registers, TLB, page table and
+//	cached translations, and load those of "cpu".  Main memory,
+//	and everything derived from it, is shared.
+//
+//	Called by the scheduler, along with switching to the thread
+//	that is running on "cpu".
+//----------------------------------------------------------------------
+
+void
+Machine::SwitchCPU(int cpu)
+{
+    CPUState *from = &cpus[currentCPU];
+    CPUState *to = &cpus[cpu];
+    int i;
+
+    ASSERT((cpu >= 0) && (cpu < numCPUs));
+    if (cpu == currentCPU)
+	return;
+    for (i = 0; i < NumTotalRegs; i++) {
+	from->registers[i] = registers[i];
+	registers[i] = to->registers[i];
+    }
+    from->tlb = tlb;
+    from->pageTable = pageTable;
+    from->pageTableSize = pageTableSize;
+    from->fetchCache = fetchCache;
+    from->readCache = readCache;
+    from->writeCache = writeCache;
+
+    tlb = to->tlb;
+    pageTable = to->pageTable;
+    pageTableSize = to->pageTableSize;
+    fetchCache = to->fetchCache;
+    readCache = to->readCache;
+    writeCache = to->writeCache;
+    currentCPU = cpu;
+}
+
+//----------------------------------------------------------------------
+// Machine::PrintCPUStats
+// 	Print the number of user instructions each simulated CPU ran.
+//	Only counted with more than one CPU; otherwise it is just the
+//	number of user ticks.
+//----------------------------------------------------------------------
+
+void
+Machine::PrintCPUStats()
+{
+    for (int cpu = 0; cpu < numCPUs; cpu++) {
+	cout << "CPU " << cpu << ": user instructions ";
+	cout << cpus[cpu].numInstructions << "\n";
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::PrintProfile
+// 	Report the profile of the user programs that have run, if we
+//	have been keeping one.
+//----------------------------------------------------------------------
+
+void
+Machine::PrintProfile()
+{
+    if (profiler != NULL)
+	profiler->Report();
+}
+
+//----------------------------------------------------------------------
+// Machine::WriteSnapshot
+// 	Write the contents of main memory and of the registers to the
+//	open file "fd", as part of a snapshot of the whole machine (see
+//	snapshot.h).  Only called between user instructions, with no
+//	delayed load outstanding and a single CPU.
+//----------------------------------------------------------------------
+
+void
+Machine::WriteSnapshot(int fd)
+{
+    WriteFile(fd, mainMemory, MemorySize);
+    WriteFile(fd, (char *) registers, NumTotalRegs * sizeof(int));
+}
+
+//----------------------------------------------------------------------
+// Machine::ReadSnapshot
+// 	Load main memory and the registers from a snapshot written by
+//	WriteSnapshot.  All of memory has changed underneath any decoded
+//	or translated instructions, so they are thrown away.
+//----------------------------------------------------------------------
+
+void
+Machine::ReadSnapshot(int fd)
+{
+    Read(fd, mainMemory, MemorySize);
+    Read(fd, (char *) registers, NumTotalRegs * sizeof(int));
+    for (int page = 0; page < NumPhysPages; page++)
+	InvalidateCodePage(page);
+    FlushTranslations();
 }
 
 //----------------------------------------------------------------------
@@ -102,6 +284,9 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
 {
     DEBUG(dbgMach, "Exception: " << exceptionNames[which]);
     
+    FlushTicks();			// time up to the trapping instruction
+    if (blockEngine != NULL)
+	blockEngine->ChargeCompleted();
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
     kernel->interrupt->setStatus(SystemMode);
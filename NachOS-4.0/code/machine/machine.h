@@ -39,6 +39,7 @@ const int NumPhysPages = 128;
 
 const int MemorySize = (NumPhysPages * PageSize);
 const int TLBSize = 4;			// if there is a TLB, make it small
+const int MaxCPUs = 8;			// most processors we can simulate
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -90,10 +91,30 @@ enum ExceptionType { NoException,           // Everything ok!
 
 class Instruction;
 class Interrupt;
+class BlockEngine;
+class Profiler;
+
+// The state private to each simulated processor.  The processors share
+// main memory (and the decode cache); only one processor's state is
+// loaded into the Machine at a time (see Machine::SwitchCPU).
+
+class CPUState {
+  public:
+    int registers[NumTotalRegs];	// the processor's register file
+    TranslationEntry *tlb;		// its TLB, if there is one
+    TranslationEntry *pageTable;	// its page table register
+    unsigned int pageTableSize;
+    CachedTranslation fetchCache;	// its cached translations
+    CachedTranslation readCache;
+    CachedTranslation writeCache;
+    int numInstructions;		// # of user instructions it has run
+};
 
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
+    Machine(bool debug, bool translateBlocks, bool batchTicks,
+		bool cacheTranslations, int numCPUs, char *profileFile);
+    				// Initialize the simulation of the hardware
 				// for running user programs
     ~Machine();			// De-allocate the data structures
 
@@ -105,6 +126,21 @@ class Machine {
     void WriteRegister(int num, int value);
 				// store a value into a CPU register
 
+// With more than one simulated CPU, Run interleaves the CPUs that have
+// a thread, an instruction at a time; the registers, TLB and page table
+// below are those of the CPU currently being simulated.
+
+    int NumCPUs() { return numCPUs; }
+    int CurrentCPU() { return currentCPU; }
+    void SwitchCPU(int cpu);	// Save the state of the current CPU, and
+				// load that of "cpu"
+    void PrintCPUStats();	// Print how much each CPU ran
+    void PrintProfile();	// Report the profile of user code, if
+				// we are keeping one
+
+    void WriteSnapshot(int fd);	// Save main memory and the registers
+    void ReadSnapshot(int fd);	// to an open file, or load them back
+
 // Data structures accessible to the Nachos kernel -- main memory and the
 // page table/TLB.
 //
@@ -128,7 +164,8 @@ class Machine {
 // 
 // For simplicity, both the page table pointer and the TLB pointer are
 // public.  However, while there can be multiple page tables (one per address
-// space, stored in memory), there is only one TLB (implemented in hardware).
+// space, stored in memory), there is only one TLB per CPU (implemented in
+// hardware).
 // Thus the TLB pointer should be considered as *read-only*, although 
 // the contents of the TLB are free to be modified by the kernel software.
 
@@ -138,23 +175,44 @@ class Machine {
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
 
+    void FlushTranslations();	// Forget the translations cached from the
+				// page table.  The kernel must call this
+				// after switching page tables, or changing
+				// an entry of the current one.
+
     bool ReadMem(int addr, int size, int* value);
     bool WriteMem(int addr, int size, int value);
     				// Read or write 1, 2, or 4 bytes of virtual 
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
+
+    void InvalidateCodePage(int physPage);
+				// Throw away any predecoded (or translated)
+				// instructions for a page of physical memory.  The
+				// kernel must call this after writing
+				// to mainMemory directly (i.e., not 
+				// through WriteMem)
   private:
 
 // Routines internal to the machine simulation -- DO NOT call these directly
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
 
-    void OneInstruction(Instruction *instr); 	
-    				// Run one instruction of a user program.
-    
+    bool OneInstruction(); 	// Run one instruction of a user program.
+				// Return FALSE if it trapped.
+
+    int InstructionsUntilDue();	// # of instructions we can run before
+				// the next interrupt might come due
+    void FlushTicks();		// Charge the ticks of the instructions
+				// run since the last Interrupt::OneTick
 
+    Instruction *FetchInstruction();
+    				// Return the decoded instruction at PC,
+				// from the decode cache if possible
 
-    ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
+
+    ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing,
+				CachedTranslation *cache = NULL);
     				// Translate an address, and check for 
 				// alignment.  Set the use and dirty bits in 
 				// the translation entry appropriately,
@@ -173,12 +231,36 @@ class Machine {
 
     int registers[NumTotalRegs]; // CPU registers, for executing user programs
 
+    Instruction *decodeCache;	// predecoded instructions, one for each
+				// word of physical memory
+    bool codePage[NumPhysPages];// TRUE if decodeCache may hold a valid
+				// instruction from this page, or code
+				// has been translated from it
+    bool cacheTranslations;	// use the caches below?
+    CachedTranslation fetchCache; // last translation used for each kind
+    CachedTranslation readCache;  // of memory access (see Translate)
+    CachedTranslation writeCache;
+
+    BlockEngine *blockEngine;	// runs user code a basic block at a time;
+				// NULL to use OneInstruction
+    Profiler *profiler;		// counts what user code runs; NULL
+				// unless profiling
+
+    bool batchTicks;		// charge ticks for runs of instructions at
+				// once, rather than after each instruction
+    int uncharged;		// # of instructions run, but not yet charged
+
+    int numCPUs;		// # of simulated processors
+    int currentCPU;		// the one whose state is loaded
+    CPUState *cpus;		// saved state of each processor
+
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
 
     friend class Interrupt;		// calls DelayedLoad()    
+    friend class BlockEngine;		// the alternative to OneInstruction
 };
 
 extern void ExceptionHandler(ExceptionType which);
@@ -186,6 +268,9 @@ extern void ExceptionHandler(ExceptionType which);
 				// user system calls and exceptions
 				// Defined in exception.cc
 
+extern void MultDivSelfTest();	// Check the simulation of multiply and
+				// divide.  Defined in mipssim.cc
+
 
 // Routines for converting Words and Short Words to and from the
 // simulated machine's format of little endian.  If the host machine
@@ -0,0 +1,932 @@
+// mipsblock.cc
+//	Routines to run user programs a basic block at a time, using
+//	translated (direct-threaded) code.  See mipsblock.h.
+//
+//	Each op handler below simulates exactly what the corresponding
+//	case of Machine::OneInstruction does; the two must be kept in
+//	step.  Handlers never touch their instruction again after raising
+//	an exception, since the block it came from may have been discarded
+//	by the time the kernel returns to us.
+
+
+#include "debug.h"
+#include "machine.h"
+#include "mipssim.h"
+#include "mipsblock.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// Op handlers
+// 	One routine for each MIPS instruction.  The handler computes the
+//	instruction's effect on the registers and memory, and records
+//	any branch (in engine->pcAfter) and delayed load (in
+//	engine->nextLoadReg/nextLoadValue); BlockEngine::Execute then
+//	advances the program counters, just as OneInstruction does.
+//----------------------------------------------------------------------
+
+static bool
+DoADD(BlockEngine *e, Instruction *instr)
+{
+    int *registers = e->registers;
+    int sum = registers[instr->rs] + registers[instr->rt];
+
+    if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+	((registers[instr->rs] ^ sum) & SIGN_BIT)) {
+	e->Raise(OverflowException, 0);
+	return FALSE;
+    }
+    registers[instr->rd] = sum;
+    return TRUE;
+}
+
+static bool
+DoADDI(BlockEngine *e, Instruction *instr)
+{
+    int *registers = e->registers;
+    int sum = registers[instr->rs] + instr->extra;
+
+    if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
+	((instr->extra ^ sum) & SIGN_BIT)) {
+	e->Raise(OverflowException, 0);
+	return FALSE;
+    }
+    registers[instr->rt] = sum;
+    return TRUE;
+}
+
+static bool
+DoADDIU(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rt] = e->registers[instr->rs] + instr->extra;
+    return TRUE;
+}
+
+static bool
+DoADDU(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = e->registers[instr->rs] +
+					e->registers[instr->rt];
+    return TRUE;
+}
+
+static bool
+DoAND(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = e->registers[instr->rs] &
+					e->registers[instr->rt];
+    return TRUE;
+}
+
+static bool
+DoANDI(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rt] = e->registers[instr->rs] &
+					(instr->extra & 0xffff);
+    return TRUE;
+}
+
+static bool
+DoBEQ(BlockEngine *e, Instruction *instr)
+{
+    if (e->registers[instr->rs] == e->registers[instr->rt])
+	e->pcAfter = e->registers[NextPCReg] + IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoBGEZ(BlockEngine *e, Instruction *instr)
+{
+    if (!(e->registers[instr->rs] & SIGN_BIT))
+	e->pcAfter = e->registers[NextPCReg] + IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoBGEZAL(BlockEngine *e, Instruction *instr)
+{
+    e->registers[R31] = e->registers[NextPCReg] + 4;
+    return DoBGEZ(e, instr);
+}
+
+static bool
+DoBGTZ(BlockEngine *e, Instruction *instr)
+{
+    if (e->registers[instr->rs] > 0)
+	e->pcAfter = e->registers[NextPCReg] + IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoBLEZ(BlockEngine *e, Instruction *instr)
+{
+    if (e->registers[instr->rs] <= 0)
+	e->pcAfter = e->registers[NextPCReg] + IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoBLTZ(BlockEngine *e, Instruction *instr)
+{
+    if (e->registers[instr->rs] & SIGN_BIT)
+	e->pcAfter = e->registers[NextPCReg] + IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoBLTZAL(BlockEngine *e, Instruction *instr)
+{
+    e->registers[R31] = e->registers[NextPCReg] + 4;
+    return DoBLTZ(e, instr);
+}
+
+static bool
+DoBNE(BlockEngine *e, Instruction *instr)
+{
+    if (e->registers[instr->rs] != e->registers[instr->rt])
+	e->pcAfter = e->registers[NextPCReg] + IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoDIV(BlockEngine *e, Instruction *instr)
+{
+    int *registers = e->registers;
+
+    Div(registers[instr->rs], registers[instr->rt], TRUE,
+	&registers[HiReg], &registers[LoReg]);
+    return TRUE;
+}
+
+static bool
+DoDIVU(BlockEngine *e, Instruction *instr)
+{
+    int *registers = e->registers;
+
+    Div(registers[instr->rs], registers[instr->rt], FALSE,
+	&registers[HiReg], &registers[LoReg]);
+    return TRUE;
+}
+
+static bool
+DoJ(BlockEngine *e, Instruction *instr)
+{
+    e->pcAfter = (e->pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
+    return TRUE;
+}
+
+static bool
+DoJAL(BlockEngine *e, Instruction *instr)
+{
+    e->registers[R31] = e->registers[NextPCReg] + 4;
+    return DoJ(e, instr);
+}
+
+static bool
+DoJR(BlockEngine *e, Instruction *instr)
+{
+    e->pcAfter = e->registers[instr->rs];
+    return TRUE;
+}
+
+static bool
+DoJALR(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = e->registers[NextPCReg] + 4;
+    return DoJR(e, instr);
+}
+
+static bool
+DoLB(BlockEngine *e, Instruction *instr)
+{
+    int value;
+
+    if (!e->machine->ReadMem(e->registers[instr->rs] + instr->extra, 1, &value))
+	return FALSE;
+    if ((value & 0x80) && (instr->opCode == OP_LB))
+	value |= 0xffffff00;
+    else
+	value &= 0xff;
+    e->nextLoadReg = instr->rt;
+    e->nextLoadValue = value;
+    return TRUE;
+}
+
+static bool
+DoLH(BlockEngine *e, Instruction *instr)
+{
+    int tmp = e->registers[instr->rs] + instr->extra;
+    int value;
+
+    if (tmp & 0x1) {
+	e->Raise(AddressErrorException, tmp);
+	return FALSE;
+    }
+    if (!e->machine->ReadMem(tmp, 2, &value))
+	return FALSE;
+    if ((value & 0x8000) && (instr->opCode == OP_LH))
+	value |= 0xffff0000;
+    else
+	value &= 0xffff;
+    e->nextLoadReg = instr->rt;
+    e->nextLoadValue = value;
+    return TRUE;
+}
+
+static bool
+DoLUI(BlockEngine *e, Instruction *instr)
+{
+    HOTDEBUG(dbgMach, "Executing: LUI r" << instr->rt << ", " << instr->extra);
+    e->registers[instr->rt] = instr->extra << 16;
+    return TRUE;
+}
+
+static bool
+DoLW(BlockEngine *e, Instruction *instr)
+{
+    int tmp = e->registers[instr->rs] + instr->extra;
+    int value;
+
+    if (tmp & 0x3) {
+	e->Raise(AddressErrorException, tmp);
+	return FALSE;
+    }
+    if (!e->machine->ReadMem(tmp, 4, &value))
+	return FALSE;
+    e->nextLoadReg = instr->rt;
+    e->nextLoadValue = value;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// UnalignedWord
+// 	Read the aligned word holding an LWL/LWR/SWL/SWR operand, and
+//	return which case of Kane's tables applies (see the comments
+//	on these instructions in Machine::OneInstruction).
+//
+//	Returns -1 if the read trapped.
+//----------------------------------------------------------------------
+
+static int
+UnalignedWord(BlockEngine *e, Instruction *instr, int *addr, int *value)
+{
+    int tmp = e->registers[instr->rs] + instr->extra;
+
+#ifdef SIM_FIX
+    int byte = tmp & 0x3;
+
+    *addr = tmp - byte;
+    if (!e->machine->ReadMem(*addr, 4, value))
+	return -1;
+    return 3 - byte;
+#else
+    ASSERT((tmp & 0x3) == 0);
+    *addr = tmp;
+    if (!e->machine->ReadMem(*addr, 4, value))
+	return -1;
+    return 0;
+#endif
+}
+
+static bool
+DoLWL(BlockEngine *e, Instruction *instr)
+{
+    int *registers = e->registers;
+    int addr, value, loadValue;
+    int which = UnalignedWord(e, instr, &addr, &value);
+
+    if (which < 0)
+	return FALSE;
+    if (registers[LoadReg] == instr->rt)
+	loadValue = registers[LoadValueReg];
+    else
+	loadValue = registers[instr->rt];
+    switch (which) {
+      case 0:
+	loadValue = value;
+	break;
+      case 1:
+	loadValue = (loadValue & 0xff) | (value << 8);
+	break;
+      case 2:
+	loadValue = (loadValue & 0xffff) | (value << 16);
+	break;
+      case 3:
+	loadValue = (loadValue & 0xffffff) | (value << 24);
+	break;
+    }
+    e->nextLoadReg = instr->rt;
+    e->nextLoadValue = loadValue;
+    return TRUE;
+}
+
+static bool
+DoLWR(BlockEngine *e, Instruction *instr)
+{
+    int *registers = e->registers;
+    int addr, value, loadValue;
+    int which = UnalignedWord(e, instr, &addr, &value);
+
+    if (which < 0)
+	return FALSE;
+    if (registers[LoadReg] == instr->rt)
+	loadValue = registers[LoadValueReg];
+    else
+	loadValue = registers[instr->rt];
+    switch (which) {
+      case 0:
+	loadValue = (loadValue & 0xffffff00) | ((value >> 24) & 0xff);
+	break;
+      case 1:
+	loadValue = (loadValue & 0xffff0000) | ((value >> 16) & 0xffff);
+	break;
+      case 2:
+	loadValue = (loadValue & 0xff000000) | ((value >> 8) & 0xffffff);
+	break;
+      case 3:
+	loadValue = value;
+	break;
+    }
+    e->nextLoadReg = instr->rt;
+    e->nextLoadValue = loadValue;
+    return TRUE;
+}
+
+static bool
+DoMFHI(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = e->registers[HiReg];
+    return TRUE;
+}
+
+static bool
+DoMFLO(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = e->registers[LoReg];
+    return TRUE;
+}
+
+static bool
+DoMTHI(BlockEngine *e, Instruction *instr)
+{
+    e->registers[HiReg] = e->registers[instr->rs];
+    return TRUE;
+}
+
+static bool
+DoMTLO(BlockEngine *e, Instruction *instr)
+{
+    e->registers[LoReg] = e->registers[instr->rs];
+    return TRUE;
+}
+
+static bool
+DoMULT(BlockEngine *e, Instruction *instr)
+{
+    int *registers = e->registers;
+
+    Mult(registers[instr->rs], registers[instr->rt], TRUE,
+	 &registers[HiReg], &registers[LoReg]);
+    return TRUE;
+}
+
+static bool
+DoMULTU(BlockEngine *e, Instruction *instr)
+{
+    int *registers = e->registers;
+
+    Mult(registers[instr->rs], registers[instr->rt], FALSE,
+	 &registers[HiReg], &registers[LoReg]);
+    return TRUE;
+}
+
+static bool
+DoNOR(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = ~(e->registers[instr->rs] |
+					e->registers[instr->rt]);
+    return TRUE;
+}
+
+static bool
+DoOR(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = e->registers[instr->rs] |
+					e->registers[instr->rt];
+    return TRUE;
+}
+
+static bool
+DoORI(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rt] = e->registers[instr->rs] |
+					(instr->extra & 0xffff);
+    return TRUE;
+}
+
+static bool
+DoSB(BlockEngine *e, Instruction *instr)
+{
+    return e->machine->WriteMem((unsigned)
+		(e->registers[instr->rs] + instr->extra), 1,
+		e->registers[instr->rt]);
+}
+
+static bool
+DoSH(BlockEngine *e, Instruction *instr)
+{
+    return e->machine->WriteMem((unsigned)
+		(e->registers[instr->rs] + instr->extra), 2,
+		e->registers[instr->rt]);
+}
+
+static bool
+DoSLL(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = e->registers[instr->rt] << instr->extra;
+    return TRUE;
+}
+
+static bool
+DoSLLV(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = e->registers[instr->rt] <<
+				(e->registers[instr->rs] & 0x1f);
+    return TRUE;
+}
+
+static bool
+DoSLT(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] =
+		(e->registers[instr->rs] < e->registers[instr->rt]) ? 1 : 0;
+    return TRUE;
+}
+
+static bool
+DoSLTI(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rt] = (e->registers[instr->rs] < instr->extra) ? 1 : 0;
+    return TRUE;
+}
+
+static bool
+DoSLTIU(BlockEngine *e, Instruction *instr)
+{
+    unsigned int rs = e->registers[instr->rs];
+    unsigned int imm = instr->extra;
+
+    e->registers[instr->rt] = (rs < imm) ? 1 : 0;
+    return TRUE;
+}
+
+static bool
+DoSLTU(BlockEngine *e, Instruction *instr)
+{
+    unsigned int rs = e->registers[instr->rs];
+    unsigned int rt = e->registers[instr->rt];
+
+    e->registers[instr->rd] = (rs < rt) ? 1 : 0;
+    return TRUE;
+}
+
+static bool
+DoSRA(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = e->registers[instr->rt] >> instr->extra;
+    return TRUE;
+}
+
+static bool
+DoSRAV(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = e->registers[instr->rt] >>
+				(e->registers[instr->rs] & 0x1f);
+    return TRUE;
+}
+
+// NOTE: like OneInstruction, SRL and SRLV shift a signed int, so they
+// are arithmetic shifts on our host -- keep the two engines identical.
+
+static bool
+DoSRL(BlockEngine *e, Instruction *instr)
+{
+    int tmp = e->registers[instr->rt];
+
+    tmp >>= instr->extra;
+    e->registers[instr->rd] = tmp;
+    return TRUE;
+}
+
+static bool
+DoSRLV(BlockEngine *e, Instruction *instr)
+{
+    int tmp = e->registers[instr->rt];
+
+    tmp >>= (e->registers[instr->rs] & 0x1f);
+    e->registers[instr->rd] = tmp;
+    return TRUE;
+}
+
+static bool
+DoSUB(BlockEngine *e, Instruction *instr)
+{
+    int *registers = e->registers;
+    int diff = registers[instr->rs] - registers[instr->rt];
+
+    if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
+	((registers[instr->rs] ^ diff) & SIGN_BIT)) {
+	e->Raise(OverflowException, 0);
+	return FALSE;
+    }
+    registers[instr->rd] = diff;
+    return TRUE;
+}
+
+static bool
+DoSUBU(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = e->registers[instr->rs] -
+					e->registers[instr->rt];
+    return TRUE;
+}
+
+static bool
+DoSW(BlockEngine *e, Instruction *instr)
+{
+    return e->machine->WriteMem((unsigned)
+		(e->registers[instr->rs] + instr->extra), 4,
+		e->registers[instr->rt]);
+}
+
+static bool
+DoSWL(BlockEngine *e, Instruction *instr)
+{
+    int *registers = e->registers;
+    int addr, value;
+    int which = UnalignedWord(e, instr, &addr, &value);
+
+    if (which < 0)
+	return FALSE;
+    switch (which) {
+      case 0:
+	value = registers[instr->rt];
+	break;
+      case 1:
+	value = (value & 0xff000000) | ((registers[instr->rt] >> 8) & 0xffffff);
+	break;
+      case 2:
+	value = (value & 0xffff0000) | ((registers[instr->rt] >> 16) & 0xffff);
+	break;
+      case 3:
+	value = (value & 0xffffff00) | ((registers[instr->rt] >> 24) & 0xff);
+	break;
+    }
+    return e->machine->WriteMem(addr, 4, value);
+}
+
+static bool
+DoSWR(BlockEngine *e, Instruction *instr)
+{
+    int *registers = e->registers;
+    int addr, value;
+    int which = UnalignedWord(e, instr, &addr, &value);
+
+    if (which < 0)
+	return FALSE;
+    switch (which) {
+      case 0:
+	value = (value & 0xffffff) | (registers[instr->rt] << 24);
+	break;
+      case 1:
+	value = (value & 0xffff) | (registers[instr->rt] << 16);
+	break;
+      case 2:
+	value = (value & 0xff) | (registers[instr->rt] << 8);
+	break;
+      case 3:
+	value = registers[instr->rt];
+	break;
+    }
+    return e->machine->WriteMem(addr, 4, value);
+}
+
+static bool
+DoSYSCALL(BlockEngine *e, Instruction *instr)
+{
+    e->Raise(SyscallException, 0);
+    return FALSE;
+}
+
+static bool
+DoXOR(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rd] = e->registers[instr->rs] ^
+					e->registers[instr->rt];
+    return TRUE;
+}
+
+static bool
+DoXORI(BlockEngine *e, Instruction *instr)
+{
+    e->registers[instr->rt] = e->registers[instr->rs] ^
+					(instr->extra & 0xffff);
+    return TRUE;
+}
+
+static bool
+DoIllegal(BlockEngine *e, Instruction *instr)
+{
+    e->Raise(IllegalInstrException, 0);
+    return FALSE;
+}
+
+static bool
+DoUnknown(BlockEngine *e, Instruction *instr)
+{
+    ASSERT(FALSE);		// Decode never produces this opcode
+    return FALSE;
+}
+
+// The handler for each opCode, indexed by opCode (see mipssim.h).
+// A constant table, so that machines on different host threads 
+// can share it (see "-farm" in main.cc).
+
+static const OpHandler opHandlers[MaxOpcode + 1] = {
+    DoUnknown,	DoADD,		DoADDI,		DoADDIU,	// 0-3
+    DoADDU,	DoAND,		DoANDI,		DoBEQ,		// 4-7
+    DoBGEZ,	DoBGEZAL,	DoBGTZ,		DoBLEZ,		// 8-11
+    DoBLTZ,	DoBLTZAL,	DoBNE,		DoUnknown,	// 12-15
+    DoDIV,	DoDIVU,		DoJ,		DoJAL,		// 16-19
+    DoJALR,	DoJR,		DoLB,		DoLB,		// 20-23
+    DoLH,	DoLH,		DoLUI,		DoLW,		// 24-27
+    DoLWL,	DoLWR,		DoUnknown,	DoMFHI,		// 28-31
+    DoMFLO,	DoUnknown,	DoMTHI,		DoMTLO,		// 32-35
+    DoMULT,	DoMULTU,	DoNOR,		DoOR,		// 36-39
+    DoORI,	DoUnknown,	DoSB,		DoSH,		// 40-43
+    DoSLL,	DoSLLV,		DoSLT,		DoSLTI,		// 44-47
+    DoSLTIU,	DoSLTU,		DoSRA,		DoSRAV,		// 48-51
+    DoSRL,	DoSRLV,		DoSUB,		DoSUBU,		// 52-55
+    DoSW,	DoSWL,		DoSWR,		DoXOR,		// 56-59
+    DoXORI,	DoSYSCALL,	DoIllegal,	DoIllegal	// 60-63
+};
+
+//----------------------------------------------------------------------
+// TranslatedBlock::TranslatedBlock, ~TranslatedBlock
+// 	Allocate and de-allocate the threaded code for a block.
+//----------------------------------------------------------------------
+
+TranslatedBlock::TranslatedBlock(int addr, int n)
+{
+    physAddr = addr;
+    numOps = n;
+    ops = new TranslatedOp[n];
+    valid = TRUE;
+    nextStale = NULL;
+}
+
+TranslatedBlock::~TranslatedBlock()
+{
+    delete [] ops;
+}
+
+//----------------------------------------------------------------------
+// BlockEngine::BlockEngine
+// 	Initialize the block translation engine for a machine; no code
+//	is translated until it is first run.
+//----------------------------------------------------------------------
+
+BlockEngine::BlockEngine(Machine *m)
+{
+    machine = m;
+    registers = m->registers;
+    blocks = new TranslatedBlock *[MemorySize / 4];
+    for (int i = 0; i < MemorySize / 4; i++)
+	blocks[i] = NULL;
+    stale = NULL;
+    completed = 0;
+}
+
+//----------------------------------------------------------------------
+// BlockEngine::~BlockEngine
+// 	De-allocate every translated block.
+//----------------------------------------------------------------------
+
+BlockEngine::~BlockEngine()
+{
+    FreeStaleBlocks();
+    for (int i = 0; i < MemorySize / 4; i++)
+	delete blocks[i];
+    delete [] blocks;
+}
+
+//----------------------------------------------------------------------
+// BlockEngine::Run
+// 	Simulate the execution of a user-level program, a basic block at
+//	a time.  Called by Machine::Run; never returns.
+//
+//	Interrupts are checked once per block, after the ticks of all its
+//	instructions have been charged.  When the PC can't start a block
+//	(we're in a branch delay slot that wasn't part of the previous
+//	block, or the PC doesn't translate), we fall back on the reference
+//	interpreter for one instruction.
+//
+//	Like Machine::Run, this routine is re-entrant.
+//----------------------------------------------------------------------
+
+void
+BlockEngine::Run()
+{
+    TranslatedBlock *block;
+    int ticks;
+
+    for (;;) {
+	FreeStaleBlocks();
+	block = Lookup();
+	if (block != NULL) {
+	    ticks = Execute(block);
+	} else {
+	    machine->OneInstruction();
+	    ticks = 1;
+	}
+	kernel->interrupt->MultiTick(ticks);
+    }
+}
+
+//----------------------------------------------------------------------
+// BlockEngine::Lookup
+// 	Return the block starting at the current PC, translating it
+//	if necessary.  Returns NULL if the next instruction must be
+//	run on its own.
+//----------------------------------------------------------------------
+
+TranslatedBlock *
+BlockEngine::Lookup()
+{
+    int physAddr;
+    TranslatedBlock *block;
+
+    if (registers[NextPCReg] != registers[PCReg] + 4)
+	return NULL;		// in the delay slot of a taken branch
+    if (machine->Translate(registers[PCReg], &physAddr, 4, FALSE,
+				&machine->fetchCache) != NoException)
+	return NULL;		// OneInstruction will raise the exception
+
+    block = blocks[physAddr / 4];
+    if (block == NULL) {
+	block = Translate(physAddr);
+	blocks[physAddr / 4] = block;
+    }
+    return block;
+}
+
+//----------------------------------------------------------------------
+// BlockEngine::Translate
+// 	Decode the basic block starting at "physAddr" into threaded code.
+//	The block ends after the delay slot of the first branch or jump,
+//	after an instruction that always traps, or at the end of the page.
+//----------------------------------------------------------------------
+
+TranslatedBlock *
+BlockEngine::Translate(int physAddr)
+{
+    TranslatedOp ops[PageSize / 4];
+    TranslatedBlock *block;
+    int pageEnd = (physAddr / PageSize + 1) * PageSize;
+    int numOps = 0;
+    bool inDelaySlot = FALSE;
+
+    for (int addr = physAddr; addr < pageEnd; addr += 4) {
+	Instruction *instr = &ops[numOps].instr;
+
+	instr->value =
+	    WordToHost(*(unsigned int *) &machine->mainMemory[addr]);
+	instr->Decode();
+	instr->valid = TRUE;
+	ASSERT(instr->opCode <= MaxOpcode);
+	ops[numOps].handler = opHandlers[(int) instr->opCode];
+	numOps++;
+
+	if (inDelaySlot || IsTrap(instr->opCode))
+	    break;
+	inDelaySlot = IsBranch(instr->opCode);
+    }
+
+    block = new TranslatedBlock(physAddr, numOps);
+    for (int i = 0; i < numOps; i++)
+	block->ops[i] = ops[i];
+    machine->codePage[physAddr / PageSize] = TRUE;  // so stores invalidate us
+
+    DEBUG(dbgMach, "Translated block at " << physAddr << ", " << numOps
+						<< " instructions");
+    return block;
+}
+
+//----------------------------------------------------------------------
+// BlockEngine::Execute
+// 	Run a translated block, starting at its first instruction.
+//
+//	After each instruction, do the same bookkeeping as the end of
+//	Machine::OneInstruction: the delayed load, then the program
+//	counters.  We stop early if an instruction traps, or if it stored
+//	over the block itself (the rest of the block is stale).
+//
+//	Returns the number of ticks still to be charged.  If an
+//	instruction trapped, RaiseException has already charged the ones
+//	before it (see ChargeCompleted), leaving only the trapping one.
+//----------------------------------------------------------------------
+
+int
+BlockEngine::Execute(TranslatedBlock *block)
+{
+    TranslatedOp *op = block->ops;
+    TranslatedOp *end = block->ops + block->numOps;
+
+    for (; op < end; op++) {
+	completed = op - block->ops;
+	pcAfter = registers[NextPCReg] + 4;
+	nextLoadReg = 0;
+	nextLoadValue = 0;
+
+	if (!(*op->handler)(this, &op->instr))
+	    return 1;			// trapped; don't touch "block" again
+
+	machine->DelayedLoad(nextLoadReg, nextLoadValue);
+	registers[PrevPCReg] = registers[PCReg];
+	registers[PCReg] = registers[NextPCReg];
+	registers[NextPCReg] = pcAfter;
+
+	if (!block->valid) {		// self-modifying code
+	    completed = 0;
+	    return op - block->ops + 1;
+	}
+    }
+    completed = 0;
+    return block->numOps;
+}
+
+//----------------------------------------------------------------------
+// BlockEngine::ChargeCompleted
+// 	Charge the ticks for the instructions of the running block that
+//	have finished.  Called by Machine::RaiseException, so that the
+//	kernel sees the same time (and any interrupts that came due) on
+//	a trap as it does under the reference interpreter.
+//----------------------------------------------------------------------
+
+void
+BlockEngine::ChargeCompleted()
+{
+    int n = completed;
+
+    completed = 0;		// before MultiTick, which may switch threads
+    if (n > 0)
+	kernel->interrupt->MultiTick(n);
+}
+
+//----------------------------------------------------------------------
+// BlockEngine::InvalidateRange
+// 	Discard every block translated from any of "size" bytes of
+//	physical memory starting at "physAddr", because they have been
+//	overwritten.  The bytes must all lie in one page; since blocks
+//	never cross a page either, only the blocks starting in that page
+//	need to be checked.
+//
+//	Discarded blocks are only deleted at the next block boundary,
+//	since the running block may be among them.
+//----------------------------------------------------------------------
+
+void
+BlockEngine::InvalidateRange(int physAddr, int size)
+{
+    int first = (physAddr / PageSize) * (PageSize / 4);
+    int last = (physAddr + size - 1) / 4;
+    TranslatedBlock *block;
+
+    ASSERT((physAddr / PageSize) == ((physAddr + size - 1) / PageSize));
+    for (int i = first; i <= last; i++) {
+	block = blocks[i];
+	if ((block != NULL) &&
+		(block->physAddr + block->numOps * 4 > physAddr)) {
+	    block->valid = FALSE;
+	    block->nextStale = stale;
+	    stale = block;
+	    blocks[i] = NULL;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// BlockEngine::FreeStaleBlocks
+// 	Delete the blocks discarded by InvalidateRange.
+//----------------------------------------------------------------------
+
+void
+BlockEngine::FreeStaleBlocks()
+{
+    TranslatedBlock *block;
+
+    while (stale != NULL) {
+	block = stale;
+	stale = block->nextStale;
+	delete block;
+    }
+}
@@ -0,0 +1,100 @@
+// mipsblock.h
+//	Data structures for the basic-block translation engine, an
+//	alternative to the instruction-at-a-time interpreter in mipssim.cc.
+//
+//	The engine carves user code into basic blocks -- straight-line
+//	runs of instructions ending just after a branch (and its delay
+//	slot), at a trap, or at the end of a physical page.  Each block
+//	is translated once into an array of (handler, decoded instruction)
+//	pairs, so running it is a tight loop of indirect calls rather than
+//	a fetch, translate and switch per instruction ("direct-threaded
+//	code").  The ticks for a whole block are charged in one shot when
+//	it finishes, so interrupts are only taken at block boundaries;
+//	exceptions still happen at the exact instruction that causes them.
+//
+//	Blocks are named by the physical address of their first
+//	instruction and never cross a page boundary, so they stay valid
+//	across context switches.  They are discarded whenever the
+//	memory they were translated from changes (see InvalidateRange).
+
+#ifndef MIPSBLOCK_H
+#define MIPSBLOCK_H
+
+#include "machine.h"
+#include "mipssim.h"
+
+class BlockEngine;
+
+// Simulate one instruction; return FALSE if it trapped to the kernel
+// (in which case the exception has already been raised).
+
+typedef bool (*OpHandler)(BlockEngine *engine, Instruction *instr);
+
+// One instruction of a translated block.
+
+class TranslatedOp {
+  public:
+    OpHandler handler;		// routine that simulates the instruction
+    Instruction instr;		// the instruction, already decoded
+};
+
+// A basic block of user code, translated into threaded code.
+
+class TranslatedBlock {
+  public:
+    TranslatedBlock(int physAddr, int numOps);
+    ~TranslatedBlock();
+
+    int physAddr;		// where the block starts in mainMemory
+    int numOps;			// number of instructions in the block
+    TranslatedOp *ops;		// the instructions, in program order
+    bool valid;			// FALSE once memory under the block changes
+    TranslatedBlock *nextStale; // list of discarded blocks awaiting delete
+};
+
+// The following class runs user code for the Machine, a block at a
+// time.  The state the op handlers need (registers, the next PC, the
+// pending delayed load) is public so that they can be plain functions.
+
+class BlockEngine {
+  public:
+    BlockEngine(Machine *m);	// initialize an empty translation table
+    ~BlockEngine();		// de-allocate all translated blocks
+
+    void Run();			// run the user program; never returns
+
+    void InvalidateRange(int physAddr, int size);
+    				// Discard any block translated from these
+				// bytes of physical memory (all in one page)
+
+    void ChargeCompleted();	// charge the ticks of the instructions of
+				// the current block that have already
+				// completed; called before trapping
+
+// State used by the op handlers
+
+    Machine *machine;		// the simulated CPU and memory
+    int *registers;		// == machine->registers
+    int pcAfter;		// the value of NextPCReg after this instruction
+    int nextLoadReg;		// delayed load started by this instruction
+    int nextLoadValue;
+
+    void Raise(ExceptionType which, int badVAddr)
+	{ machine->RaiseException(which, badVAddr); }
+
+  private:
+    TranslatedBlock *Lookup();	// find or build the block at the PC
+    TranslatedBlock *Translate(int physAddr);
+    				// build the block starting at physAddr
+    int Execute(TranslatedBlock *block);
+    				// run a block; return # of ticks to charge
+    void FreeStaleBlocks();	// delete blocks that have been discarded
+
+    TranslatedBlock **blocks;	// the block starting at each word of
+				// physical memory, or NULL
+    TranslatedBlock *stale;	// discarded, but not yet deleted, blocks
+    int completed;		// instructions of the running block that
+				// have finished, but not yet been charged
+};
+
+#endif // MIPSBLOCK_H
@@ -20,30 +20,10 @@
 #include "debug.h"
 #include "machine.h"
 #include "mipssim.h"
+#include "mipsblock.h"
+#include "profiler.h"
 #include "main.h"
 
-static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
-
-// The following class defines an instruction, represented in both
-// 	undecoded binary form
-//      decoded to identify
-//	    operation to do
-//	    registers to act on
-//	    any immediate operand value
-
-class Instruction {
-  public:
-    void Decode();	// decode the binary representation of the instruction
-
-    unsigned int value; // binary representation of the instruction
-
-    char opCode;     // Type of instruction.  This is NOT the same as the
-    		     // opcode field from the instruction: see defs in mips.h
-    char rs, rt, rd; // Three registers from instruction.
-    int extra;       // Immediate or target or shamt field or offset.
-                     // Immediates are sign-extended.
-};
-
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -51,20 +31,53 @@ class Instruction {
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
+//
+//	Rather than calling Interrupt::OneTick after every instruction,
+//	we run in bursts that end when the next pending interrupt comes
+//	due (see InstructionsUntilDue).  The instructions before the last
+//	one of a burst can't cause any interrupt, so we just add up their
+//	ticks and charge them in one go; the last one gets a full OneTick.
+//	A trap ends the burst early, after RaiseException has charged
+//	the ticks so far (see FlushTicks), so the kernel always sees the
+//	same time it would if ticks were charged one at a time.
+//
+//	If the block translation engine is enabled, it does the work
+//	instead -- except when single stepping or profiling, which need
+//	control after every instruction.
+//
+//	With more than one CPU, neither shortcut is taken: each CPU that
+//	has a thread runs one instruction in turn (see Interrupt::NextCPU),
+//	so that user programs really do run in parallel.
 //----------------------------------------------------------------------
 
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
+    int burst;
 
     if (debug->IsEnabled('m')) {
         cout << "Starting program in thread: " << kernel->currentThread->getName();
 	cout << ", at time: " << kernel->stats->totalTicks << "\n";
     }
     kernel->interrupt->setStatus(UserMode);
+    if (numCPUs > 1) {
+	for (;;) {
+	    cpus[currentCPU].numInstructions++;
+	    OneInstruction();
+	    kernel->interrupt->NextCPU();	// may load another CPU
+	    if (singleStep && (runUntilTime <= kernel->stats->totalTicks))
+		Debugger();
+	}
+    }
+    if ((blockEngine != NULL) && !singleStep && (profiler == NULL))
+	blockEngine->Run();		// never returns
     for (;;) {
-        OneInstruction(instr);
+	burst = InstructionsUntilDue();
+	while ((--burst > 0) && OneInstruction())
+	    uncharged++;
+	if (burst == 0)			// no trap: run the last instruction
+	    OneInstruction();
+	FlushTicks();
 	kernel->interrupt->OneTick();
 	if (singleStep && (runUntilTime <= kernel->stats->totalTicks))
 	  Debugger();
@@ -115,26 +128,34 @@ TypeToReg(RegType reg, Instruction *instr)
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
 //	and the register set.
+//
+//	The one exception is the decode cache (see FetchInstruction),
+//	which the kernel must keep coherent with main memory by calling
+//	InvalidateCodePage.
+//
+//	Returns FALSE if the instruction trapped to the kernel.
 //----------------------------------------------------------------------
 
-void
-Machine::OneInstruction(Instruction *instr)
+bool
+Machine::OneInstruction()
 {
 #ifdef SIM_FIX
     int byte;       // described in Kane for LWL,LWR,...
 #endif
 
-    int raw;
+    Instruction *instr;
     int nextLoadReg = 0; 	
     int nextLoadValue = 0; 	// record delayed load operation, to apply
 				// in the future
 
     // Fetch instruction 
-    if (!ReadMem(registers[PCReg], 4, &raw))
-	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
+    if ((instr = FetchInstruction()) == NULL)
+	return FALSE;			// exception occurred
+    if ((profiler != NULL) && IsTrap(instr->opCode))
+	profiler->CountInstruction(currentCPU, registers[PCReg],
+					instr->opCode);	// it never completes
 
+#ifndef NO_HOT_DEBUG
     if (debug->IsEnabled('m')) {
         struct OpString *str = &opStrings[instr->opCode];
 	char buf[80];
@@ -145,6 +166,7 @@ Machine::OneInstruction(Instruction *instr)
 	     TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
         cout << "\t" << buf << "\n";
     }
+#endif
     
     // Compute next pc, but don't install in case there's an error or branch.
     int pcAfter = registers[NextPCReg] + 4;
@@ -159,7 +181,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = sum;
 	break;
@@ -169,7 +191,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
 	    ((instr->extra ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rt] = sum;
 	break;
@@ -225,28 +247,14 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_DIV:
-	if (registers[instr->rt] == 0) {
-	    registers[LoReg] = 0;
-	    registers[HiReg] = 0;
-	} else {
-	    registers[LoReg] =  registers[instr->rs] / registers[instr->rt];
-	    registers[HiReg] = registers[instr->rs] % registers[instr->rt];
-	}
+	Div(registers[instr->rs], registers[instr->rt], TRUE,
+	    &registers[HiReg], &registers[LoReg]);
 	break;
 	
       case OP_DIVU:	  
-	  rs = (unsigned int) registers[instr->rs];
-	  rt = (unsigned int) registers[instr->rt];
-	  if (rt == 0) {
-	      registers[LoReg] = 0;
-	      registers[HiReg] = 0;
-	  } else {
-	      tmp = rs / rt;
-	      registers[LoReg] = (int) tmp;
-	      tmp = rs % rt;
-	      registers[HiReg] = (int) tmp;
-	  }
-	  break;
+	Div(registers[instr->rs], registers[instr->rt], FALSE,
+	    &registers[HiReg], &registers[LoReg]);
+	break;
 	
       case OP_JAL:
 	registers[R31] = registers[NextPCReg] + 4;
@@ -264,7 +272,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_LBU:
 	tmp = registers[instr->rs] + instr->extra;
 	if (!ReadMem(tmp, 1, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x80) && (instr->opCode == OP_LB))
 	    value |= 0xffffff00;
@@ -279,10 +287,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x1) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!ReadMem(tmp, 2, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x8000) && (instr->opCode == OP_LH))
 	    value |= 0xffff0000;
@@ -293,7 +301,7 @@ Machine::OneInstruction(Instruction *instr)
 	break;
       	
       case OP_LUI:
-	DEBUG(dbgMach, "Executing: LUI r" << instr->rt << ", " << instr->extra);
+	HOTDEBUG(dbgMach, "Executing: LUI r" << instr->rt << ", " << instr->extra);
 	registers[instr->rt] = instr->extra << 16;
 	break;
 	
@@ -301,10 +309,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x3) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
 	break;
@@ -324,7 +332,7 @@ Machine::OneInstruction(Instruction *instr)
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
         if (!ReadMem(tmp-byte, 4, &value))
-            return;
+            return FALSE;
 #else
 	// ReadMem assumes all 4 byte requests are aligned on an even 
 	// word boundary.  Also, the little endian/big endian swap code would
@@ -332,7 +340,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 #endif
 
 	if (registers[LoadReg] == instr->rt)
@@ -376,7 +384,7 @@ Machine::OneInstruction(Instruction *instr)
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
         if (!ReadMem(tmp-byte, 4, &value))
-            return;
+            return FALSE;
 #else
 	// ReadMem assumes all 4 byte requests are aligned on an even 
 	// word boundary.  Also, the little endian/big endian swap code would
@@ -384,7 +392,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 #endif
 
 	if (registers[LoadReg] == instr->rt)
@@ -458,13 +466,13 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SB:
 	if (!WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SH:
 	if (!WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SLL:
@@ -534,7 +542,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = diff;
 	break;
@@ -546,7 +554,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SW:
 	if (!WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SWL:	  
@@ -562,7 +570,7 @@ Machine::OneInstruction(Instruction *instr)
         byte = tmp & 0x3;
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
         if (!ReadMem(tmp-byte, 4, &value))
-            return;
+            return FALSE;
 
         // DEBUG('P', "Value 0x%X\n",value);
 #else
@@ -572,7 +580,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 #endif
 
 #ifdef SIM_FIX
@@ -599,12 +607,12 @@ Machine::OneInstruction(Instruction *instr)
 	}
 #ifndef SIM_FIX
         if (!WriteMem((tmp & ~0x3), 4, value))
-            return;
+            return FALSE;
 #else
         // DEBUG('P', "Value 0x%X\n",value);
 
         if (!WriteMem((tmp - byte), 4, value))
-            return;
+            return FALSE;
 #endif // SIM_FIX
 	break;
     	
@@ -617,7 +625,7 @@ Machine::OneInstruction(Instruction *instr)
         ASSERT((tmp & 0x3) == 0);  
 
         if (!ReadMem((tmp & ~0x3), 4, &value))
-            return;
+            return FALSE;
 #else
         // The only difference between this code and the BIG ENDIAN code
         // is that the ReadMem call is guaranteed an aligned access as 
@@ -630,7 +638,7 @@ Machine::OneInstruction(Instruction *instr)
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
         if (!ReadMem(tmp-byte, 4, &value))
-            return;
+            return FALSE;
         // DEBUG('P', "Value 0x%X\n",value);
 #endif // SIM_FIX
 
@@ -656,12 +664,12 @@ Machine::OneInstruction(Instruction *instr)
 
 #ifndef SIM_FIX
         if (!WriteMem((tmp & ~0x3), 4, value))
-            return;
+            return FALSE;
 #else
         // DEBUG('P', "Value 0x%X\n",value);
 
         if (!WriteMem((tmp - byte), 4, value))
-            return;
+            return FALSE;
 #endif // SIM_FIX
 
 
@@ -669,7 +677,7 @@ Machine::OneInstruction(Instruction *instr)
     	
       case OP_SYSCALL:
 	RaiseException(SyscallException, 0);
-	return; 
+	return FALSE; 
 	
       case OP_XOR:
 	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -682,7 +690,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_RES:
       case OP_UNIMP:
 	RaiseException(IllegalInstrException, 0);
-	return;
+	return FALSE;
 	
       default:
 	ASSERT(FALSE);
@@ -692,12 +700,125 @@ Machine::OneInstruction(Instruction *instr)
     
     // Do any delayed load operation
     DelayedLoad(nextLoadReg, nextLoadValue);
+
+    // Count it only now, so that an instruction re-executed after a
+    // page fault is counted once.
+    if (profiler != NULL)
+	profiler->CountInstruction(currentCPU, registers[PCReg],
+							instr->opCode);
     
     // Advance program counters.
     registers[PrevPCReg] = registers[PCReg];	// for debugging, in case we
 						// are jumping into lala-land
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::InstructionsUntilDue
+// 	Return how many user instructions we can run before one of them
+//	might cause a pending interrupt to come due -- the last of them
+//	reaches the deadline.  Always at least 1.
+//
+//	Returns 1 when single stepping, or when we've been asked to charge
+//	ticks one instruction at a time.  When nothing is pending at all
+//	(the timer may have been stopped), only a trap to the kernel can
+//	change that, and that ends the burst anyway.
+//----------------------------------------------------------------------
+
+static const int MaxBurst = 1 << 20;	// instructions, with nothing pending
+
+int
+Machine::InstructionsUntilDue()
+{
+    int when, now = kernel->stats->totalTicks;
+
+    if (singleStep || !batchTicks)
+	return 1;
+    when = kernel->interrupt->NextDueTick();
+    if (when < 0)		// nothing pending
+	return MaxBurst;
+    if (when <= now)		// already overdue
+	return 1;
+    return divRoundUp(when - now, UserTick);
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTicks
+// 	Charge the ticks of the user instructions that have run since
+//	the last call to OneTick.  None of them can have made an interrupt
+//	come due (see InstructionsUntilDue), so we just advance the clock.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTicks()
+{
+    if (uncharged > 0) {
+	kernel->interrupt->AddTicks(uncharged * UserTick);
+	uncharged = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchInstruction
+// 	Return the decoded form of the instruction at the current PC.
+//
+//	Decoded instructions are cached, one slot for each word of 
+//	physical memory, so a loop only pays for translating its PC on
+//	each pass -- not for reading memory or for Instruction::Decode.
+//	WriteMem invalidates a slot when the word is overwritten, and
+//	the kernel calls InvalidateCodePage when it changes memory 
+//	behind our back (loading a program, forking an address space).
+//
+//	Returns NULL if the PC could not be translated; the exception
+//	has already been raised in that case.
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::FetchInstruction()
+{
+    ExceptionType exception;
+    int physAddr;
+    Instruction *instr;
+
+    exception = Translate(registers[PCReg], &physAddr, 4, FALSE, &fetchCache);
+    if (exception != NoException) {
+	RaiseException(exception, registers[PCReg]);
+	return NULL;
+    }
+    instr = &decodeCache[physAddr / 4];
+    if (!instr->valid) {
+	instr->value = WordToHost(*(unsigned int *) &mainMemory[physAddr]);
+	instr->Decode();
+	instr->valid = TRUE;
+	codePage[physAddr / PageSize] = TRUE;
+    }
+    return instr;
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateCodePage
+// 	Discard the cached decodings of every instruction in a page
+//	of physical memory, and any blocks translated from it.
+//
+//	"physPage" -- the physical page number whose contents changed
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateCodePage(int physPage)
+{
+    ASSERT((physPage >= 0) && (physPage < NumPhysPages));
+
+    if (codePage[physPage]) {
+	Instruction *instr = &decodeCache[physPage * PageSize / 4];
+
+	for (int i = 0; i < PageSize / 4; i++)
+	    instr[i].valid = FALSE;
+	if (blockEngine != NULL)
+	    blockEngine->InvalidateRange(physPage * PageSize, PageSize);
+	codePage[physPage] = FALSE;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -766,10 +887,61 @@ Instruction::Decode()
 // 	Simulate R2000 multiplication.
 // 	The words at *hiPtr and *loPtr are overwritten with the
 // 	double-length result of the multiplication.
+//
+//	The host does the 32x32->64 bit multiply for us; ShiftAddMult
+//	is the original bit-at-a-time version, kept to check this one
+//	against (see MultDivSelfTest).
 //----------------------------------------------------------------------
 
-static void
+void
 Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr)
+{
+    unsigned long long result;
+
+    if (signedArith)
+	result = (unsigned long long) ((long long) a * (long long) b);
+    else
+	result = (unsigned long long) (unsigned int) a * (unsigned int) b;
+    *hiPtr = (int) (result >> 32);
+    *loPtr = (int) result;
+}
+
+//----------------------------------------------------------------------
+// Div
+// 	Simulate R2000 division: the quotient goes in *loPtr, and the
+//	remainder in *hiPtr.  Division by zero leaves both zero (the
+//	real hardware leaves them undefined).
+//
+//	The one signed quotient that doesn't fit in 32 bits, 
+//	0x80000000 / -1, is special-cased: the host would trap on it,
+//	where the R2000 just wraps around.
+//----------------------------------------------------------------------
+
+void
+Div(int a, int b, bool signedArith, int* hiPtr, int* loPtr)
+{
+    if (b == 0) {
+	*hiPtr = *loPtr = 0;
+    } else if (!signedArith) {
+	*loPtr = (int) ((unsigned int) a / (unsigned int) b);
+	*hiPtr = (int) ((unsigned int) a % (unsigned int) b);
+    } else if ((a == (int) SIGN_BIT) && (b == -1)) {
+	*loPtr = a;
+	*hiPtr = 0;
+    } else {
+	*loPtr = a / b;
+	*hiPtr = a % b;
+    }
+}
+
+//----------------------------------------------------------------------
+// ShiftAddMult
+// 	The original software simulation of R2000 multiplication, one
+//	bit of "a" at a time.  Only used by MultDivSelfTest.
+//----------------------------------------------------------------------
+
+static void
+ShiftAddMult(int a, int b, bool signedArith, int* hiPtr, int* loPtr)
 {
     if ((a == 0) || (b == 0)) {
 	*hiPtr = *loPtr = 0;
@@ -826,3 +998,123 @@ Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr)
     *hiPtr = (int) hi;
     *loPtr = (int) lo;
 }
+
+//----------------------------------------------------------------------
+// WideDiv
+// 	Divide the way the host does in 64 bits, with the operands sign-
+//	or zero-extended, and keep the low 32 bits of the quotient and
+//	remainder.  This shares nothing with Div, and needs no special
+//	case for SIGN_BIT / -1: in 64 bits the quotient, 2^31, fits,
+//	and truncates to SIGN_BIT.  Only used by MultDivSelfTest; the
+//	caller must rule out b == 0.
+//----------------------------------------------------------------------
+
+static void
+WideDiv(int a, int b, bool signedArith, int* hiPtr, int* loPtr)
+{
+    long long wideA, wideB;
+
+    if (signedArith) {
+	wideA = (long long) a;
+	wideB = (long long) b;
+    } else {
+	wideA = (long long) (unsigned int) a;
+	wideB = (long long) (unsigned int) b;
+    }
+    *loPtr = (int) (wideA / wideB);
+    *hiPtr = (int) (wideA % wideB);
+}
+
+//----------------------------------------------------------------------
+// MultDivSelfTest
+// 	Check Mult against ShiftAddMult, and Div against WideDiv, for
+//	edge-case operands and a batch of random ones, both signed and
+//	unsigned, and Div against results worked out by hand for the
+//	cases the hardware leaves undefined or that overflow.  Invoked
+//	by "nachos -M".
+//----------------------------------------------------------------------
+
+static int multDivEdges[] = { 0, 1, -1, 2, -2, 3, 7, -7, 0xff, 0xffff,
+	0x10000, -0x10000, 0x7fff, -0x8000, 0x12345678, -0x12345678,
+	0x7ffffffe, 0x7fffffff, (int) 0x80000000, (int) 0x80000001 };
+
+// What Div must give: dividing by zero gives 0:0 (as the original
+// simulator did; the R2000 leaves it undefined), and the signed
+// quotient that overflows wraps around.
+static struct {
+    int a, b;
+    bool signedArith;
+    int hi, lo;				// the remainder and quotient
+} divResults[] = {
+    { 7, 0, TRUE, 0, 0 },
+    { 7, 0, FALSE, 0, 0 },
+    { (int) 0x80000000, 0, TRUE, 0, 0 },
+    { (int) 0x80000000, -1, TRUE, 0, (int) 0x80000000 },
+    { (int) 0x80000000, -1, FALSE, (int) 0x80000000, 0 },
+    { -7, 2, TRUE, -1, -3 },
+    { 7, -2, TRUE, 1, -3 },
+    { -7, -2, TRUE, -1, 3 },
+    { -7, 2, FALSE, 1, 0x7ffffffc },
+    { -1, -1, FALSE, 0, 1 },
+    { 0x7fffffff, (int) 0x80000000, TRUE, 0x7fffffff, 0 },
+};
+
+static void
+CheckMultDiv(int a, int b)
+{
+    int hi, lo, refHi, refLo;
+
+    for (int s = 0; s < 2; s++) {
+	bool signedArith = (s == 0);
+
+	Mult(a, b, signedArith, &hi, &lo);
+	ShiftAddMult(a, b, signedArith, &refHi, &refLo);
+	if ((hi != refHi) || (lo != refLo)) {
+	    cerr << "Mult(" << a << ", " << b << ", " << signedArith
+		 << ") = " << hi << ":" << lo << ", expected " 
+		 << refHi << ":" << refLo << "\n";
+	    ASSERT(FALSE);
+	}
+
+	if (b == 0)			// see divResults
+	    continue;
+	Div(a, b, signedArith, &hi, &lo);
+	WideDiv(a, b, signedArith, &refHi, &refLo);
+	if ((hi != refHi) || (lo != refLo)) {
+	    cerr << "Div(" << a << ", " << b << ", " << signedArith
+		 << ") = " << hi << ":" << lo << ", expected " 
+		 << refHi << ":" << refLo << "\n";
+	    ASSERT(FALSE);
+	}
+    }
+}
+
+void
+MultDivSelfTest()
+{
+    int numEdges = sizeof(multDivEdges) / sizeof(int);
+    int numRandom = 100000;
+    int i, j;
+
+    for (i = 0; i < numEdges; i++)
+	for (j = 0; j < numEdges; j++)
+	    CheckMultDiv(multDivEdges[i], multDivEdges[j]);
+    for (i = 0; i < (int) (sizeof(divResults) / sizeof(divResults[0])); i++) {
+	int hi, lo;
+
+	Div(divResults[i].a, divResults[i].b, divResults[i].signedArith,
+								&hi, &lo);
+	if ((hi != divResults[i].hi) || (lo != divResults[i].lo)) {
+	    cerr << "Div(" << divResults[i].a << ", " << divResults[i].b
+		 << ", " << divResults[i].signedArith << ") = " << hi << ":"
+		 << lo << ", expected " << divResults[i].hi << ":"
+		 << divResults[i].lo << "\n";
+	    ASSERT(FALSE);
+	}
+    }
+    for (i = 0; i < numRandom; i++)		// RandomNumber gives 31 bits
+	CheckMultDiv((int) (RandomNumber() ^ (RandomNumber() << 16)),
+		     (int) (RandomNumber() ^ (RandomNumber() << 16)));
+    cout << "Mult/Div self test passed: " << numEdges * numEdges + numRandom
+	 << " operand pairs\n";
+}
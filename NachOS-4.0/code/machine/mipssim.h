@@ -11,6 +11,7 @@
 #define MIPSSIM_H
 
 #include "copyright.h"
+#include "utility.h"
 
 /*
  * OpCode values.  The names are straight from the MIPS
@@ -96,6 +97,57 @@
 #define SIGN_BIT	0x80000000
 #define R31		31
 
+// The following class defines an instruction, represented in both
+// 	undecoded binary form
+//      decoded to identify
+//	    operation to do
+//	    registers to act on
+//	    any immediate operand value
+
+class Instruction {
+  public:
+    void Decode();	// decode the binary representation of the instruction
+
+    unsigned int value; // binary representation of the instruction
+
+    char opCode;     // Type of instruction.  This is NOT the same as the
+    		     // opcode field from the instruction: see defs in mips.h
+    char rs, rt, rd; // Three registers from instruction.
+    int extra;       // Immediate or target or shamt field or offset.
+                     // Immediates are sign-extended.
+    bool valid;      // TRUE if this is a decoded copy of the word of
+                     // main memory it caches (see Machine::FetchInstruction)
+};
+
+extern void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
+extern void Div(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
+				// Simulate R2000 multiplication and 
+				// division (shared by both execution engines)
+
+// Classify the instructions that end a basic block: a branch or jump
+// ends it after its delay slot, and an instruction that always traps
+// to the kernel ends it immediately.
+
+static inline bool
+IsBranch(int opCode)
+{
+    switch (opCode) {
+      case OP_BEQ: case OP_BGEZ: case OP_BGEZAL: case OP_BGTZ:
+      case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL: case OP_BNE:
+      case OP_J: case OP_JAL: case OP_JALR: case OP_JR:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
+
+static inline bool
+IsTrap(int opCode)
+{
+    return (opCode == OP_SYSCALL) || (opCode == OP_RES) ||
+						(opCode == OP_UNIMP);
+}
+
 /*
  * The table below is used to translate bits 31:26 of the instruction
  * into a value suitable for the "opCode" field of a MemWord structure,
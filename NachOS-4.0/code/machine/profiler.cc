@@ -0,0 +1,294 @@
+// profiler.cc
+//	Routines to profile the user programs run by the simulator, and
+//	to report the results when Nachos halts (see profiler.h).
+//
+//	The report printed on the console lists the instruction mix and
+//	the hottest instructions and basic blocks.  The file gets every
+//	non-zero count, one per line, in a form that is easy to feed to
+//	other tools:
+//
+//		op <mnemonic> <count>
+//		pc <address> <mnemonic> <count>
+//		block <address> <runs> <ticks>
+
+#include "debug.h"
+#include "profiler.h"
+#include "stats.h"
+#include "sysdep.h"
+
+// How many of the hottest instructions and blocks to print.
+static const int ReportLength = 20;
+
+//----------------------------------------------------------------------
+// Mnemonic
+// 	Copy the name of an instruction out of its debugging format
+//	string (see opStrings in mipssim.h) into "buf".
+//----------------------------------------------------------------------
+
+static char *
+Mnemonic(int opCode, char *buf)
+{
+    char *format = opStrings[opCode].format;
+    int i;
+
+    for (i = 0; (format[i] != '\0') && (format[i] != ' ') && (i < 15); i++)
+	buf[i] = format[i];
+    buf[i] = '\0';
+    return buf;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Profiler
+// 	Start with an empty profile.
+//
+//	"name" is the file to write the full profile to, on halting.
+//----------------------------------------------------------------------
+
+Profiler::Profiler(char *name)
+{
+    fileName = name;
+    for (int op = 0; op <= MaxOpcode; op++)
+	opCounts[op] = 0;
+    totalCount = 0;
+    entries = NULL;
+    numEntries = 0;
+    for (int cpu = 0; cpu < MaxCPUs; cpu++) {
+	blockStart[cpu] = -1;
+	blockLength[cpu] = 0;
+	lastPC[cpu] = -1;
+	inDelaySlot[cpu] = FALSE;
+    }
+}
+
+Profiler::~Profiler()
+{
+    delete [] entries;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Grow
+// 	Enlarge the table of entries (at least doubling it) so that it
+//	covers word "index" of the address space.
+//----------------------------------------------------------------------
+
+void
+Profiler::Grow(int index)
+{
+    int size = (numEntries > 0) ? numEntries : PageSize / 4;
+    ProfileEntry *bigger;
+
+    while (size <= index)
+	size *= 2;
+    bigger = new ProfileEntry[size];
+    for (int i = 0; i < size; i++) {
+	if (i < numEntries) {
+	    bigger[i] = entries[i];
+	} else {
+	    bigger[i].count = 0;
+	    bigger[i].opCode = 0;
+	    bigger[i].blockRuns = 0;
+	    bigger[i].blockTicks = 0;
+	}
+    }
+    delete [] entries;
+    entries = bigger;
+    numEntries = size;
+}
+
+//----------------------------------------------------------------------
+// Profiler::EndBlock
+// 	The basic block running on "cpu" has finished; charge it.
+//----------------------------------------------------------------------
+
+void
+Profiler::EndBlock(int cpu)
+{
+    ProfileEntry *entry = &entries[blockStart[cpu] / 4];
+
+    entry->blockRuns++;
+    entry->blockTicks += blockLength[cpu] * UserTick;
+    blockStart[cpu] = -1;
+    blockLength[cpu] = 0;
+    inDelaySlot[cpu] = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Profiler::CountInstruction
+// 	Count an instruction that has just run, and keep track of the
+//	basic block it belongs to.  An instruction that faults is only
+//	counted when it is re-executed, so each counts once.
+//
+//	"cpu" is the CPU running it
+//	"pc" is its virtual address
+//	"opCode" is what kind of instruction it is
+//----------------------------------------------------------------------
+
+void
+Profiler::CountInstruction(int cpu, int pc, int opCode)
+{
+    unsigned int index = ((unsigned int) pc) / 4;
+
+    ASSERT(opCode <= MaxOpcode);
+    opCounts[opCode]++;
+    totalCount++;
+    if (index >= (unsigned int) numEntries)
+	Grow(index);
+    entries[index].count++;
+    entries[index].opCode = opCode;
+
+    if ((blockStart[cpu] >= 0) && (pc != lastPC[cpu] + 4))
+	EndBlock(cpu);			// went somewhere else
+    if (blockStart[cpu] < 0)
+	blockStart[cpu] = pc;
+    blockLength[cpu]++;
+    lastPC[cpu] = pc;
+
+    if (inDelaySlot[cpu] || IsTrap(opCode) || ((pc + 4) % PageSize == 0))
+	EndBlock(cpu);
+    else
+	inDelaySlot[cpu] = IsBranch(opCode);
+}
+
+//----------------------------------------------------------------------
+// CompareCounts
+// 	Order the indices of profile entries by decreasing count (of
+//	instructions or of block ticks), for qsort.  Per host thread,
+//	since machines in a farm may halt at the same time.
+//----------------------------------------------------------------------
+
+static __thread ProfileEntry *sortEntries;	// the entries being sorted
+static __thread int sortField;		// 0 for instructions, 1 for blocks
+
+static int
+CompareCounts(const void *x, const void *y)
+{
+    ProfileEntry *a = &sortEntries[*(const int *) x];
+    ProfileEntry *b = &sortEntries[*(const int *) y];
+    long long countA = (sortField == 0) ? a->count : a->blockTicks;
+    long long countB = (sortField == 0) ? b->count : b->blockTicks;
+
+    if (countA != countB)
+	return (countA > countB) ? -1 : 1;
+    return *(const int *) x - *(const int *) y;	// by address
+}
+
+//----------------------------------------------------------------------
+// Percent
+// 	Print "part" as a percentage of "whole".
+//----------------------------------------------------------------------
+
+static void
+Percent(long long part, long long whole)
+{
+    char buf[20];
+
+    sprintf(buf, "%6.2f%%", (whole > 0) ? (100.0 * part) / whole : 0.0);
+    cout << buf;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Report
+// 	Print the instruction mix, then the hottest instructions and basic
+//	blocks, and write the whole profile to the file.
+//----------------------------------------------------------------------
+
+void
+Profiler::Report()
+{
+    int order[MaxOpcode + 1];
+    int *hot = new int[numEntries];
+    int numHot, numOps, i, fd;
+    long long blockTotal = 0;
+    char name[16], line[80];
+
+    for (int cpu = 0; cpu < MaxCPUs; cpu++) {	// finish off open blocks
+	if (blockStart[cpu] >= 0)
+	    EndBlock(cpu);
+    }
+
+    // the instruction mix, most frequent first
+    numOps = 0;
+    for (i = 0; i <= MaxOpcode; i++) {
+	if (opCounts[i] > 0)
+	    order[numOps++] = i;
+    }
+    for (i = 1; i < numOps; i++) {	// insertion sort; there are few
+	int op = order[i], j;
+	for (j = i; (j > 0) && (opCounts[order[j - 1]] < opCounts[op]); j--)
+	    order[j] = order[j - 1];
+	order[j] = op;
+    }
+    cout << "Profile: " << totalCount << " user instructions\n";
+    cout << "Instruction mix:\n";
+    for (i = 0; i < numOps; i++) {
+	sprintf(line, "\t%-8s %14lld  ", Mnemonic(order[i], name),
+						opCounts[order[i]]);
+	cout << line;
+	Percent(opCounts[order[i]], totalCount);
+	cout << "\n";
+    }
+
+    // the hottest instructions
+    sortEntries = entries;
+    numHot = 0;
+    for (i = 0; i < numEntries; i++) {
+	if (entries[i].count > 0)
+	    hot[numHot++] = i;
+	blockTotal += entries[i].blockTicks;
+    }
+    sortField = 0;
+    qsort(hot, numHot, sizeof(int), CompareCounts);
+    cout << "Hottest instructions:\n";
+    for (i = 0; (i < numHot) && (i < ReportLength); i++) {
+	ProfileEntry *e = &entries[hot[i]];
+	sprintf(line, "\t0x%08x %-8s %14lld  ", hot[i] * 4,
+				Mnemonic(e->opCode, name), e->count);
+	cout << line;
+	Percent(e->count, totalCount);
+	cout << "\n";
+    }
+
+    // the basic blocks taking the most time
+    numHot = 0;
+    for (i = 0; i < numEntries; i++) {
+	if (entries[i].blockRuns > 0)
+	    hot[numHot++] = i;
+    }
+    sortField = 1;
+    qsort(hot, numHot, sizeof(int), CompareCounts);
+    cout << "Hottest basic blocks (start, runs, ticks, average length):\n";
+    for (i = 0; (i < numHot) && (i < ReportLength); i++) {
+	ProfileEntry *e = &entries[hot[i]];
+	sprintf(line, "\t0x%08x %12lld %14lld %6.1f  ", hot[i] * 4,
+		e->blockRuns, e->blockTicks,
+		(double) e->blockTicks / (e->blockRuns * UserTick));
+	cout << line;
+	Percent(e->blockTicks, blockTotal);
+	cout << "\n";
+    }
+
+    // everything, for other tools
+    fd = OpenForWrite(fileName);
+    for (i = 0; i < numOps; i++) {
+	sprintf(line, "op %s %lld\n", Mnemonic(order[i], name),
+						opCounts[order[i]]);
+	WriteFile(fd, line, strlen(line));
+    }
+    for (i = 0; i < numEntries; i++) {
+	if (entries[i].count > 0) {
+	    sprintf(line, "pc 0x%08x %s %lld\n", i * 4,
+		Mnemonic(entries[i].opCode, name), entries[i].count);
+	    WriteFile(fd, line, strlen(line));
+	}
+    }
+    for (i = 0; i < numEntries; i++) {
+	if (entries[i].blockRuns > 0) {
+	    sprintf(line, "block 0x%08x %lld %lld\n", i * 4,
+			entries[i].blockRuns, entries[i].blockTicks);
+	    WriteFile(fd, line, strlen(line));
+	}
+    }
+    Close(fd);
+    cout << "Full profile written to " << fileName << "\n";
+    delete [] hot;
+}
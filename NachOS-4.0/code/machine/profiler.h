@@ -0,0 +1,71 @@
+// profiler.h
+//	Data structures for profiling user programs as the simulator
+//	runs them: how many times each kind of instruction ran (the
+//	instruction mix), how many times each instruction ran, and how
+//	many ticks were spent in each basic block.
+//
+//	Instructions and blocks are named by their virtual address, so
+//	the report can be read against a disassembly of the program
+//	(e.g., "mips-objdump -d test/sort").  Processes running the same
+//	program share counts.
+//
+//	Basic blocks are found the same way the block translation engine
+//	finds them (see mipsblock.h): a block ends after the delay slot of
+//	a branch or jump, at an instruction that always traps, at the end
+//	of a page, or wherever control goes somewhere other than the next
+//	instruction (a context switch, say).  An instruction is counted
+//	once it has run, so one that page faults and is re-executed
+//	counts once, and does not split its block.
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "machine.h"
+#include "mipssim.h"
+
+// What we know about one word of user code.
+
+class ProfileEntry {
+  public:
+    long long count;		// # of times the instruction here ran
+    int opCode;			// what the instruction was, last time
+    long long blockRuns;	// # of times a basic block started here
+    long long blockTicks;	// ticks spent in those blocks
+};
+
+// The following class collects the profile, and reports it when the
+// machine halts.
+
+class Profiler {
+  public:
+    Profiler(char *fileName);	// start with an empty profile
+    ~Profiler();
+
+    void CountInstruction(int cpu, int pc, int opCode);
+    				// Called by Machine::OneInstruction for
+				// each instruction, once it has run (or
+				// trapped to the kernel, for a syscall)
+
+    void Report();		// Print the hottest opcodes, instructions
+				// and blocks, and write the whole profile
+				// to "fileName"
+
+  private:
+    void Grow(int index);	// make room for entry "index"
+    void EndBlock(int cpu);	// charge the running block on "cpu"
+
+    char *fileName;		// where to write the full profile
+    long long opCounts[MaxOpcode + 1]; // # of instructions run of
+				// each kind
+    long long totalCount;	// # of instructions run in all
+    ProfileEntry *entries;	// one per word of user code, by
+    int numEntries;		// virtual address
+
+    // the basic block each CPU is in the middle of
+    int blockStart[MaxCPUs];	// its first instruction, or -1
+    int blockLength[MaxCPUs];	// # of instructions run in it so far
+    int lastPC[MaxCPUs];	// the last instruction run
+    bool inDelaySlot[MaxCPUs];	// is the next one a delay slot?
+};
+
+#endif // PROFILER_H
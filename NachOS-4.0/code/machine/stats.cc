@@ -21,7 +21,10 @@ Statistics::Statistics()
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
-    numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPageFaults = numPageEvictions = numPageWritebacks = 0;
+    numDeferredForks = 0;
+    numPacketsSent = numPacketsRecvd = 0;
+    numContextSwitches = 0;
 }
 
 //----------------------------------------------------------------------
@@ -39,7 +42,88 @@ Statistics::Print()
 		cout << ", writes " << numDiskWrites << "\n";
 		cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
-    cout << "Paging: faults " << numPageFaults << "\n";
+    cout << "Paging: faults " << numPageFaults;
+		cout << ", evictions " << numPageEvictions;
+		cout << ", writebacks " << numPageWritebacks;
+		cout << ", deferred forks " << numDeferredForks << "\n";
     cout << "Network I/O: packets received " << numPacketsRecvd;
 		cout << ", sent " << numPacketsSent << "\n";
+    cout << "Scheduling: context switches " << numContextSwitches << "\n";
+    wakeupLatency.Print("woken threads");
+    yieldLatency.Print("pre-empted threads");
+}
+
+//----------------------------------------------------------------------
+// LatencyHistogram::LatencyHistogram
+// 	Start with no waits counted.
+//----------------------------------------------------------------------
+
+LatencyHistogram::LatencyHistogram()
+{
+    for (int i = 0; i < LatencyBuckets; i++)
+	counts[i] = 0;
+    numWaits = 0;
+    totalTicks = 0;
+    maxTicks = 0;
+}
+
+//----------------------------------------------------------------------
+// LatencyHistogram::Record
+// 	Count a wait of "ticks" in its bucket.
+//----------------------------------------------------------------------
+
+void
+LatencyHistogram::Record(int ticks)
+{
+    int bucket = 0;
+
+    while ((ticks >> bucket) > 0 && (bucket < LatencyBuckets - 1))
+	bucket++;
+    counts[bucket]++;
+    numWaits++;
+    totalTicks += ticks;
+    if (ticks > maxTicks)
+	maxTicks = ticks;
+}
+
+//----------------------------------------------------------------------
+// LatencyHistogram::Print
+// 	Print the number of waits in each bucket (leaving out empty
+//	ones at either end), with a bar to show its share of them all.
+//
+//	"title" says whose waits these are
+//----------------------------------------------------------------------
+
+void
+LatencyHistogram::Print(char *title)
+{
+    const int BarLength = 40;
+    int first, last;
+    char line[100];
+
+    if (numWaits == 0)
+	return;
+    for (first = 0; counts[first] == 0; first++)
+	;
+    for (last = LatencyBuckets - 1; counts[last] == 0; last--)
+	;
+    sprintf(line, "Scheduling latency, %s: %d waits, mean %.1f, max %d ticks\n",
+			title, numWaits, totalTicks / numWaits, maxTicks);
+    cout << line;
+    for (int i = first; i <= last; i++) {
+	int low = (i == 0) ? 0 : 1 << (i - 1);
+
+	if (i == 0)
+	    sprintf(line, "\t%8d          ", 0);
+	else if (i == LatencyBuckets - 1)
+	    sprintf(line, "\t%8d ..       ", low);
+	else
+	    sprintf(line, "\t%8d .. %-6d", low, (1 << i) - 1);
+	cout << line;
+	sprintf(line, " %8d %6.2f%% ", counts[i], (100.0 * counts[i]) / numWaits);
+	cout << line;
+	for (int j = (BarLength * counts[i]) / numWaits; j > 0; j--)
+	    cout << "*";
+	cout << "\n";
+    }
 }
@@ -13,6 +13,29 @@
 
 #include "copyright.h"
 
+// The following class counts how long threads wait, in ticks, between
+// becoming ready to run and getting a CPU.  The counts are kept in
+// buckets by powers of two: bucket 0 is for no wait, bucket i for
+// waits of 2^(i-1) to 2^i - 1 ticks, and the last bucket for all
+// longer ones.
+
+const int LatencyBuckets = 18;
+
+class LatencyHistogram {
+  public:
+    LatencyHistogram();		// initialize everything to zero
+
+    void Record(int ticks);	// count a wait of "ticks"
+    void Print(char *title);	// print the histogram, if there is
+				// anything in it
+
+  private:
+    int counts[LatencyBuckets];	// # of waits in each bucket
+    int numWaits;		// # of waits in all
+    double totalTicks;		// the total of the waits
+    int maxTicks;		// the longest wait
+};
+
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
 // many user instructions executed, etc.
@@ -33,8 +56,19 @@ class Statistics {
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numPageEvictions;	// number of pages evicted from memory
+    int numPageWritebacks;	// number of evicted pages written to swap
+    int numDeferredForks;	// number of forks that had to wait for
+				// memory (see MemoryManager::admitProcess)
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numContextSwitches;	// number of times a thread was given a CPU
+
+    LatencyHistogram wakeupLatency;	// how long threads that were woken
+					// up (or just forked) waited to run
+    LatencyHistogram yieldLatency;	// how long threads that gave up
+					// the CPU (or were pre-empted)
+					// waited to run again
 
     Statistics(); 		// initialize everything to zero
 
@@ -55,6 +89,7 @@ const int RotationTime = 500; 	// time disk takes to rotate one sector
 const int SeekTime =	 500;  	// time disk takes to seek past one track
 const int ConsoleTime =	 100;	// time to read or write one character
 const int NetworkTime =	 100;  	// time to send or receive one packet
-const int TimerTicks = 	 100;  	// (average) time between timer interrupts
+const int TimerTicks = 	 100;  	// (average) time between timer interrupts,
+				// unless the kernel sets another time slice
 
 #endif // STATS_H
@@ -5,7 +5,7 @@
 //      This means it can be used for implementing time-slicing.
 //
 //      We emulate a hardware timer by scheduling an interrupt to occur
-//      every time stats->totalTicks has increased by TimerTicks.
+//      every time stats->totalTicks has increased by the timer's interval.
 //
 //      In order to introduce some randomness into time-slicing, if "doRandom"
 //      is set, then the interrupt is comes after a random number of ticks.
@@ -33,16 +33,37 @@
 //      "doRandom" -- if true, arrange for the interrupts to occur
 //		at random, instead of fixed, intervals.
 //      "toCall" is the interrupt handler to call when the timer expires.
+//	"target" is the CPU that the timer belongs to, or AnyCPU.
+//	"ticks" is the (average) time between interrupts.
 //----------------------------------------------------------------------
 
-Timer::Timer(bool doRandom, CallBackObj *toCall)
+Timer::Timer(bool doRandom, CallBackObj *toCall, int target, int ticks)
 {
+    ASSERT(ticks > 0);
     randomize = doRandom;
     callPeriodically = toCall;
+    interval = ticks;
+    cpu = target;
     disable = FALSE;
+    stopped = FALSE;
+    armed = FALSE;
     SetInterrupt();
 }
 
+//----------------------------------------------------------------------
+// Timer::Start
+//      Start interrupting again, after Stop: the next interrupt comes
+//	an interval from now (unless one is already on its way).
+//----------------------------------------------------------------------
+
+void
+Timer::Start()
+{
+    stopped = FALSE;
+    if (!armed)
+	SetInterrupt();
+}
+
 //----------------------------------------------------------------------
 // Timer::CallBack
 //      Routine called when interrupt is generated by the hardware 
@@ -52,30 +73,34 @@ Timer::Timer(bool doRandom, CallBackObj *toCall)
 void 
 Timer::CallBack() 
 {
+    armed = FALSE;
+
     // invoke the Nachos interrupt handler for this device
     callPeriodically->CallBack();
     
     SetInterrupt();	// do last, to let software interrupt handler
-    			// decide if it wants to disable future interrupts
+    			// decide if it wants to disable (or stop)
+			// future interrupts
 }
 
 //----------------------------------------------------------------------
 // Timer::SetInterrupt
 //      Cause a timer interrupt to occur in the future, unless
-//	future interrupts have been disabled.  The delay is either
-//	fixed or random.
+//	future interrupts have been disabled or stopped.  The delay
+//	is either fixed or random.
 //----------------------------------------------------------------------
 
 void
 Timer::SetInterrupt() 
 {
-    if (!disable) {
-       int delay = TimerTicks;
+    if (!disable && !stopped) {
+       int delay = interval;
     
        if (randomize) {
-	     delay = 1 + (RandomNumber() % (TimerTicks * 2));
+	     delay = 1 + (RandomNumber() % (interval * 2));
         }
        // schedule the next timer device interrupt
-       kernel->interrupt->Schedule(this, delay, TimerInt);
+       kernel->interrupt->Schedule(this, delay, TimerInt, cpu);
+       armed = TRUE;
     }
 }
@@ -6,11 +6,16 @@
 //	having a thread go to sleep for a specific period of time. 
 //
 //	We emulate a hardware timer by scheduling an interrupt to occur
-//	every time stats->totalTicks has increased by TimerTicks.
+//	every time stats->totalTicks has increased by the timer's interval
+//	(TimerTicks, unless the kernel asks for another).
 //
 //	In order to introduce some randomness into time-slicing, if "doRandom"
 //	is set, then the interrupt comes after a random number of ticks.
 //
+//	The timer can be stopped, and started again later, so that it
+//	doesn't interrupt when there is nothing for the kernel to do
+//	about it.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
@@ -27,20 +32,29 @@
 // The following class defines a hardware timer. 
 class Timer : public CallBackObj {
   public:
-    Timer(bool doRandom, CallBackObj *toCall);
+    Timer(bool doRandom, CallBackObj *toCall, int cpu, int ticks);
 				// Initialize the timer, and callback to "toCall"
-				// every time slice.
+				// every "ticks" (a time slice), on "cpu".
     virtual ~Timer() {}
     
     void Disable() { disable = TRUE; }
     				// Turn timer device off, so it doesn't
 				// generate any more interrupts.
+    void Stop() { stopped = TRUE; }
+    				// Don't generate any more interrupts
+				// (after one already on its way) until
+				// started again
+    void Start();		// Carry on interrupting, from now
 
   private:
     bool randomize;		// set if we need to use a random timeout delay
-    CallBackObj *callPeriodically; // call this every TimerTicks time units 
+    CallBackObj *callPeriodically; // call this every "interval" ticks
+    int interval;		// the (average) time between interrupts
+    int cpu;			// the CPU it interrupts, or AnyCPU
     bool disable;		// turn off the timer device after next
     				// interrupt.
+    bool stopped;		// don't interrupt again until Start
+    bool armed;			// is an interrupt on its way?
     
     void CallBack();		// called internally when the hardware
 				// timer generates an interrupt
@@ -31,6 +31,8 @@
 
 #include "copyright.h"
 #include "main.h"
+#include "mipssim.h"
+#include "mipsblock.h"
 
 // Routines for converting Words and Short Words to and from the
 // simulated machine's format of little endian.  These end up
@@ -89,9 +91,9 @@ Machine::ReadMem(int addr, int size, int *value)
     ExceptionType exception;
     int physicalAddress;
     
-    DEBUG(dbgAddr, "Reading VA " << addr << ", size " << size);
+    HOTDEBUG(dbgAddr, "Reading VA " << addr << ", size " << size);
     
-    exception = Translate(addr, &physicalAddress, size, FALSE);
+    exception = Translate(addr, &physicalAddress, size, FALSE, &readCache);
     if (exception != NoException) {
 	RaiseException(exception, addr);
 	return FALSE;
@@ -115,7 +117,7 @@ Machine::ReadMem(int addr, int size, int *value)
       default: ASSERT(FALSE);
     }
     
-    DEBUG(dbgAddr, "\tvalue read = " << *value);
+    HOTDEBUG(dbgAddr, "\tvalue read = " << *value);
     return (TRUE);
 }
 
@@ -138,13 +140,18 @@ Machine::WriteMem(int addr, int size, int value)
     ExceptionType exception;
     int physicalAddress;
      
-    DEBUG(dbgAddr, "Writing VA " << addr << ", size " << size << ", value " << value);
+    HOTDEBUG(dbgAddr, "Writing VA " << addr << ", size " << size << ", value " << value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
+    exception = Translate(addr, &physicalAddress, size, TRUE, &writeCache);
     if (exception != NoException) {
 	RaiseException(exception, addr);
 	return FALSE;
     }
+    if (codePage[physicalAddress / PageSize]) {	// storing over code?
+	decodeCache[physicalAddress / 4].valid = FALSE;
+	if (blockEngine != NULL)
+	    blockEngine->InvalidateRange(physicalAddress, size);
+    }
     switch (size) {
       case 1:
 	mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
@@ -179,21 +186,26 @@ Machine::WriteMem(int addr, int size, int value)
 //	"physAddr" -- the place to store the physical address
 //	"size" -- the amount of memory being read or written
 // 	"writing" -- if TRUE, check the "read-only" bit in the TLB
+//	"cache" -- if not NULL, the last translation made for this kind
+//		of access.  If it is for the same page we use it without
+//		looking at the page table; otherwise we replace it.
+//		The use and dirty bits were set when it was filled in.
 //----------------------------------------------------------------------
 
 ExceptionType
-Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
+Machine::Translate(int virtAddr, int* physAddr, int size, bool writing,
+			CachedTranslation *cache)
 {
     int i;
     unsigned int vpn, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
 
-    DEBUG(dbgAddr, "\tTranslate " << virtAddr << (writing ? " , write" : " , read"));
+    HOTDEBUG(dbgAddr, "\tTranslate " << virtAddr << (writing ? " , write" : " , read"));
 
 // check for alignment errors
     if (((size == 4) && (virtAddr & 0x3)) || ((size == 2) && (virtAddr & 0x1))){
-	DEBUG(dbgAddr, "Alignment problem at " << virtAddr << ", size " << size);
+	HOTDEBUG(dbgAddr, "Alignment problem at " << virtAddr << ", size " << size);
 	return AddressErrorException;
     }
     
@@ -206,12 +218,18 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     vpn = (unsigned) virtAddr / PageSize;
     offset = (unsigned) virtAddr % PageSize;
     
+    if ((cache != NULL) && (cache->virtualPage == (int) vpn)) {
+	*physAddr = cache->frameBase + offset;
+	HOTDEBUG(dbgAddr, "phys addr = " << *physAddr << " (cached)");
+	return NoException;
+    }
+
     if (tlb == NULL) {		// => page table => vpn is index into table
 	if (vpn >= pageTableSize) {
-	    DEBUG(dbgAddr, "Illegal virtual page # " << virtAddr);
+	    HOTDEBUG(dbgAddr, "Illegal virtual page # " << virtAddr);
 	    return AddressErrorException;
 	} else if (!pageTable[vpn].valid) {
-	    DEBUG(dbgAddr, "Invalid virtual page # " << virtAddr);
+	    HOTDEBUG(dbgAddr, "Invalid virtual page # " << virtAddr);
 	    return PageFaultException;
 	}
 	entry = &pageTable[vpn];
@@ -222,7 +240,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 		break;
 	    }
 	if (entry == NULL) {				// not found
-    	    DEBUG(dbgAddr, "Invalid TLB entry for this virtual page!");
+    	    HOTDEBUG(dbgAddr, "Invalid TLB entry for this virtual page!");
     	    return PageFaultException;		// really, this is a TLB fault,
 						// the page may be in memory,
 						// but not in the TLB
@@ -230,7 +248,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
-	DEBUG(dbgAddr, "Write to read-only page at " << virtAddr);
+	HOTDEBUG(dbgAddr, "Write to read-only page at " << virtAddr);
 	return ReadOnlyException;
     }
     pageFrame = entry->physicalPage;
@@ -238,7 +256,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
     if (pageFrame >= NumPhysPages) { 
-	DEBUG(dbgAddr, "Illegal pageframe " << pageFrame);
+	HOTDEBUG(dbgAddr, "Illegal pageframe " << pageFrame);
 	return BusErrorException;
     }
     entry->use = TRUE;		// set the use, dirty bits
@@ -246,6 +264,10 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	entry->dirty = TRUE;
     *physAddr = pageFrame * PageSize + offset;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
-    DEBUG(dbgAddr, "phys addr = " << *physAddr);
+    if ((cache != NULL) && (tlb == NULL) && cacheTranslations) {
+	cache->virtualPage = vpn;
+	cache->frameBase = pageFrame * PageSize;
+    }
+    HOTDEBUG(dbgAddr, "phys addr = " << *physAddr);
     return NoException;
 }
@@ -42,4 +42,20 @@ class TranslationEntry {
 			// page is modified.
 };
 
+// The following class remembers the last translation the machine used
+// for one kind of access (instruction fetch, load or store), so that
+// another access to the same page needn't walk the page table.  It is
+// only used with a linear page table, and must be flushed whenever
+// the page table changes (see Machine::FlushTranslations).
+
+class CachedTranslation {
+  public:
+    void Flush() { virtualPage = -1; }
+    				// forget the translation
+
+    int virtualPage;		// the page number in virtual memory,
+				// or -1 if nothing is cached
+    int frameBase;		// where the page starts in mainMemory
+};
+
 #endif
@@ -19,6 +19,8 @@
 #include "copyright.h"
 #include "post.h"
 
+__thread Pool *Mail::pool = NULL;
+
 //----------------------------------------------------------------------
 // Mail::Mail
 //      Initialize a single mail message, by concatenating the headers to
@@ -161,7 +163,7 @@ PostOfficeInput::PostOfficeInput(int nBoxes)
 
     Thread *t = new Thread("postal worker");
 
-    t->Fork(PostOfficeInput::PostalDelivery, this);
+    t->Fork(PostOfficeInput::PostalDelivery, this, SmallStackSize);
 }
 
 //----------------------------------------------------------------------
@@ -33,6 +33,7 @@
 #include "network.h"
 #include "synchlist.h"
 #include "synch.h"
+#include "pool.h"
 
 // Mailbox address -- uniquely identifies a mailbox on a given machine.
 // A mailbox is just a place for temporary storage for messages.
@@ -71,6 +72,13 @@ class Mail {
      PacketHeader pktHdr;	// Header appended by Network
      MailHeader mailHdr;	// Header appended by PostOffice
      char data[MaxMailSize];	// Payload -- message data
+
+     void *operator new(size_t size)	// kept in a pool, for re-use
+	{ return PoolAllocate(&pool, "Mail", size); }
+     void operator delete(void *mail) { PoolFree(pool, mail); }
+
+  private:
+     static __thread Pool *pool;	// this host thread's messages
 };
 
 // The following class defines a single mailbox, or temporary storage
@@ -27,7 +27,11 @@ main()
 	buffer[--i] = '\0';
 
 	if( i > 0 ) {
-		newProc = Exec(buffer);
+		newProc = Fork();
+		if( newProc == 0 ) {
+		    Exec(buffer);
+		    Exit(1);	/* couldn't run it */
+		}
 		Join(newProc);
 	}
     }
@@ -1,8 +1,7 @@
 // alarm.cc
 //	Routines to use a hardware timer device to provide a
-//	software alarm clock.  For now, we just provide time-slicing.
-//
-//	Not completely implemented.
+//	software alarm clock: time-slicing, and waking threads up after
+//	a delay (see alarm.h).
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -11,6 +10,7 @@
 #include "copyright.h"
 #include "alarm.h"
 #include "main.h"
+#include "synch.h"
 
 //----------------------------------------------------------------------
 // Alarm::Alarm
@@ -18,16 +18,61 @@
 //
 //      "doRandom" -- if true, arrange for the hardware interrupts to 
 //		occur at random, instead of fixed, intervals.
+//	"numCPUs" -- each simulated CPU has its own timer, so that
+//		each one is time-sliced separately.
+//	"quantumTicks" -- the time slice.
+//	"adapt" -- if true, adapt the time slice to each thread.
 //----------------------------------------------------------------------
 
-Alarm::Alarm(bool doRandom)
+Alarm::Alarm(bool doRandom, int numCPUs, int quantumTicks, bool adapt)
 {
-    timer = new Timer(doRandom, this);
+    int interval;
+
+    ASSERT(quantumTicks > 0);
+    quantum = quantumTicks;
+    adaptive = adapt;
+    stopped = FALSE;
+    sleepers = new ThreadQueue;
+    wakeup = new AlarmWakeup(this);
+    nextWakeup = -1;
+    interval = adaptive ? quantum / AdaptiveRange : quantum;
+    if (interval < 1)
+	interval = 1;
+
+    numTimers = numCPUs;
+    timers = new Timer *[numTimers];
+    ticks = new AlarmTick *[numTimers];
+    for (int i = 0; i < numTimers; i++)
+	ticks[i] = new AlarmTick(this, i);
+    if (numTimers == 1) {
+	timers[0] = new Timer(doRandom, ticks[0], AnyCPU, interval);
+    } else {
+	for (int cpu = 0; cpu < numTimers; cpu++)
+	    timers[cpu] = new Timer(doRandom, ticks[cpu], cpu, interval);
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::~Alarm
+//      Shut down the timers.
+//----------------------------------------------------------------------
+
+Alarm::~Alarm()
+{
+    for (int cpu = 0; cpu < numTimers; cpu++) {
+	delete timers[cpu];
+	delete ticks[cpu];
+    }
+    delete [] timers;
+    delete [] ticks;
+    delete sleepers;
+    delete wakeup;
 }
 
 //----------------------------------------------------------------------
-// Alarm::CallBack
-//	Software interrupt handler for the timer device. The timer device is
+// Alarm::Tick
+//	Software interrupt handler for the timer device.  "which" is the
+//	timer that went off (see AlarmTick). The timer device is
 //	set up to interrupt the CPU periodically (once every TimerTicks).
 //	This routine is called each time there is a timer interrupt,
 //	with interrupts disabled.
@@ -39,17 +84,224 @@ Alarm::Alarm(bool doRandom)
 //	if the interrupted thread called Yield at the point it is 
 //	was interrupted.
 //
-//	For now, just provide time-slicing.  Only need to time slice 
-//      if we're currently running something (in other words, not idle).
+//	The timers only provide time-slicing; sleepers are woken up by
+//	AlarmWakeup.  Only need to time slice 
+//      if we're currently running something (in other words, not idle),
+//	and there is something else to run: if not, stop the timer
+//	until there is (see ThreadReady).  With adaptive time slices,
+//	only switch once the current thread has used up its own.
 //----------------------------------------------------------------------
 
 void 
-Alarm::CallBack() 
+Alarm::Tick(int which) 
 {
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
+    Thread *thread = kernel->currentThread;
     
-    if (status != IdleMode) {
+    if (kernel->scheduler->NoneReady()) {
+	DEBUG(dbgInt, "Nothing else to run; stopping the timer");
+	timers[which]->Stop();
+	stopped = TRUE;
+    } else if (status != IdleMode) {
+	if (adaptive) {
+	    int q = QuantumOf(thread);
+
+	    if (kernel->stats->totalTicks - thread->dispatchTick < q)
+		return;			// not used up yet
+	    if (q < quantum * AdaptiveRange)
+		thread->quantum = 2 * q;
+	}
 	interrupt->YieldOnReturn();
     }
 }
+
+//----------------------------------------------------------------------
+// AlarmTick::CallBack
+// 	Interrupt handler for a timer: pass on which one it was.
+//----------------------------------------------------------------------
+
+void
+AlarmTick::CallBack()
+{
+    alarm->Tick(which);
+}
+
+//----------------------------------------------------------------------
+// Alarm::QuantumOf
+// 	Return the time slice of "thread": its own if it has one yet,
+//	otherwise the one set for this run.
+//----------------------------------------------------------------------
+
+int
+Alarm::QuantumOf(Thread *thread)
+{
+    return (thread->quantum > 0) ? thread->quantum : quantum;
+}
+
+//----------------------------------------------------------------------
+// Alarm::ThreadReady
+// 	Called by the scheduler when a thread becomes ready to run.
+//	There may now be something to switch to, so start any timer
+//	that has been stopped.
+//----------------------------------------------------------------------
+
+void
+Alarm::ThreadReady()
+{
+    if (stopped) {
+	DEBUG(dbgInt, "Restarting the timer");
+	for (int i = 0; i < numTimers; i++)
+	    timers[i]->Start();
+	stopped = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::ThreadBlocking
+// 	Called when "thread" gives up the CPU to wait for something.
+//	With adaptive time slices, if it used less than half of its
+//	own, halve it.
+//----------------------------------------------------------------------
+
+void
+Alarm::ThreadBlocking(Thread *thread)
+{
+    int q;
+
+    if (!adaptive)
+	return;
+    q = QuantumOf(thread);
+    if ((kernel->stats->totalTicks - thread->dispatchTick < q / 2)
+				&& (q > quantum / AdaptiveRange) && (q > 1))
+	thread->quantum = q / 2;
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+// 	Put the current thread to sleep for (at least) "x" ticks.  It
+//	goes on the sleep queue, in order of when it is due (after any
+//	due at the same time), and the wakeup handler is set for the
+//	first sleeper, if that is now earlier.
+//
+//	"x" -- how long to sleep; returns at once if not positive.
+//----------------------------------------------------------------------
+
+void
+Alarm::WaitUntil(int x)
+{
+    IntStatus oldLevel;
+    Thread *thread = kernel->currentThread;
+    Thread *after;
+
+    if (x <= 0)
+	return;
+    oldLevel = kernel->interrupt->SetLevel(IntOff);
+    thread->wakeTick = kernel->stats->totalTicks + x;
+    DEBUG(dbgThread, "Thread " << thread->getName() << " sleeping until "
+						<< thread->wakeTick);
+    for (after = sleepers->Front(); after != NULL; after = sleepers->Next(after)) {
+	if (thread->wakeTick < after->wakeTick)
+	    break;
+    }
+    sleepers->InsertBefore(thread, after);
+    ScheduleWakeup();
+    thread->Sleep(FALSE);
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Alarm::ScheduleWakeup
+// 	Make sure the wakeup handler goes off when the first sleeper is
+//	due.  If it is already set for then or earlier, leave it; if it
+//	is set for later, that interrupt can't be taken back, so it
+//	will just find no one to wake up.
+//----------------------------------------------------------------------
+
+void
+Alarm::ScheduleWakeup()
+{
+    Thread *first = sleepers->Front();
+    int now = kernel->stats->totalTicks;
+
+    if ((first == NULL) || ((nextWakeup >= 0) && (nextWakeup <= first->wakeTick)))
+	return;
+    nextWakeup = (first->wakeTick > now) ? first->wakeTick : now + 1;
+    kernel->interrupt->Schedule(wakeup, nextWakeup - now, TimerInt);
+}
+
+//----------------------------------------------------------------------
+// Alarm::WakeSleepers
+// 	Called from the wakeup interrupt handler.  Make every sleeper
+//	that is due ready to run, and set the handler for the next one.
+//----------------------------------------------------------------------
+
+void
+Alarm::WakeSleepers()
+{
+    int now = kernel->stats->totalTicks;
+    Thread *thread;
+
+    if ((nextWakeup >= 0) && (nextWakeup <= now))
+	nextWakeup = -1;		// this is it, not an earlier one
+    while (((thread = sleepers->Front()) != NULL) && (thread->wakeTick <= now)) {
+	sleepers->RemoveFront();
+	DEBUG(dbgThread, "Waking up " << thread->getName());
+	kernel->scheduler->ReadyToRun(thread);
+    }
+    ScheduleWakeup();
+}
+
+//----------------------------------------------------------------------
+// AlarmWakeup::CallBack
+// 	Interrupt handler for the sleep queue.
+//----------------------------------------------------------------------
+
+void
+AlarmWakeup::CallBack()
+{
+    alarm->WakeSleepers();
+}
+
+//----------------------------------------------------------------------
+// Alarm::SelfTest, SleepTestHelper
+// 	Test the sleep queue, by forking threads that sleep for different
+//	lengths of time, and checking that they wake up in order, and
+//	no earlier than they asked to.
+//----------------------------------------------------------------------
+
+static const int NumSleepers = 3;
+static int sleepOrder[NumSleepers];	// the delays, in order of waking
+static int numAwake;
+static Semaphore *awake;
+
+static void
+SleepTestHelper(int delay)
+{
+    int start = kernel->stats->totalTicks;
+
+    kernel->alarm->WaitUntil(delay);
+    ASSERT(kernel->stats->totalTicks >= start + delay);
+    cout << "slept " << delay << " ticks, woke at "
+				<< kernel->stats->totalTicks << "\n";
+    sleepOrder[numAwake++] = delay;
+    awake->V();
+}
+
+void
+Alarm::SelfTest()
+{
+    static int delays[NumSleepers] = { 3000, 1000, 2000 };
+
+    awake = new Semaphore("awake", 0);
+    numAwake = 0;
+    for (int i = 0; i < NumSleepers; i++) {
+	Thread *t = new Thread("sleeper");
+	t->Fork((VoidFunctionPtr) SleepTestHelper, (void *) delays[i]);
+    }
+    for (int i = 0; i < NumSleepers; i++)
+	awake->P();
+    for (int i = 1; i < NumSleepers; i++)
+	ASSERT(sleepOrder[i - 1] < sleepOrder[i]);
+    delete awake;
+}
@@ -8,7 +8,21 @@
 //	From this, we provide the ability for a thread to be
 //	woken up after a delay; we also provide time-slicing.
 //
-//	NOTE: this abstraction is not completely implemented.
+//	The time slice (quantum) can be set for each run.  It can also
+//	be adaptive: each thread then has its own quantum, which doubles
+//	each time the thread uses all of it (it is CPU-bound) and halves
+//	each time the thread blocks having used less than half of it
+//	(it is waiting for I/O), within a factor of AdaptiveRange of the
+//	quantum set.  The timer then interrupts AdaptiveRange times as
+//	often, to check on the current thread.
+//
+//	When no thread is ready to run, a time slice can't switch to
+//	anything, so the timers are stopped until one is.
+//
+//	Threads waiting in WaitUntil are kept on a sleep queue, soonest
+//	first, and the timer is set to go off once, when the first of
+//	them is due, rather than every time slice: if everything is
+//	asleep, simulated time jumps straight to the next wakeup.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -21,22 +35,81 @@
 #include "utility.h"
 #include "callback.h"
 #include "timer.h"
+#include "thread.h"
+
+class Alarm;
+
+// The interrupt handler for one of the timers: tells the alarm clock
+// which timer it was, so that it stops that one if need be.
+
+class AlarmTick : public CallBackObj {
+  public:
+    AlarmTick(Alarm *a, int t) { alarm = a; which = t; }
+
+  private:
+    Alarm *alarm;		// whose timer it is
+    int which;			// the timer's index in alarm->timers: its
+				// CPU, or 0 if there is only one timer
+
+    void CallBack();
+};
+
+// The interrupt handler for the sleep queue: called when the first
+// thread on it is due to wake up.
+
+class AlarmWakeup : public CallBackObj {
+  public:
+    AlarmWakeup(Alarm *a) { alarm = a; }
+
+  private:
+    Alarm *alarm;		// whose sleep queue it is
+
+    void CallBack();
+};
+
+const int AdaptiveRange = 4;	// how far adaptive quanta can stray
 
 // The following class defines a software alarm clock. 
-class Alarm : public CallBackObj {
+class Alarm {
   public:
-    Alarm(bool doRandomYield);	// Initialize the timer, and callback 
-				// to "toCall" every time slice.
-    ~Alarm() { delete timer; }
+    Alarm(bool doRandomYield, int numCPUs, int quantum, bool adaptive);
+    				// Initialize the timers, to interrupt
+				// every time slice.
+    ~Alarm();
     
-    void WaitUntil(int x);	// suspend execution until time > now + x
-                                // this method is not yet implemented
+    void WaitUntil(int x);	// suspend execution until time >= now + x
+
+    int Quantum() { return quantum; }
+    				// the time slice set for this run
+    void ThreadReady();		// A thread has become ready to run
+    void ThreadBlocking(Thread *thread);
+    				// "thread" is giving up the CPU to wait
+
+    void SelfTest();		// test whether WaitUntil is working
 
   private:
-    Timer *timer;		// the hardware timer device
+    Timer **timers;		// the hardware timer device of each CPU
+    AlarmTick **ticks;		// and the handler for each
+    int numTimers;
+    int quantum;		// the time slice
+    bool adaptive;		// does each thread have its own quantum?
+    bool stopped;		// have any of the timers been stopped?
+
+    int QuantumOf(Thread *thread);
+    				// the time slice of "thread"
+
+    ThreadQueue *sleepers;	// threads in WaitUntil, soonest first
+    AlarmWakeup *wakeup;	// handler for waking them up
+    int nextWakeup;		// when the handler is next due, or -1
+
+    void ScheduleWakeup();	// Make sure the handler is due in time
+				// for the first sleeper
+    void WakeSleepers();	// Wake up every sleeper that is due
+    friend class AlarmWakeup;
 
-    void CallBack();		// called when the hardware
-				// timer generates an interrupt
+    void Tick(int which);	// called when hardware timer "which"
+				// generates an interrupt
+    friend class AlarmTick;
 };
 
 #endif // ALARM_H
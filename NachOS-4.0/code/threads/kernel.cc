@@ -27,7 +27,19 @@
 Kernel::Kernel(int argc, char **argv)
 {
     randomSlice = FALSE; 
+    quantum = TimerTicks;
+    adaptiveQuantum = FALSE;
     debugUserProg = FALSE;
+    translateBlocks = FALSE;
+    batchTicks = TRUE;
+    cacheTranslations = TRUE;
+    numCPUs = 1;
+    profileFile = NULL;		// default is not to profile
+    eventQueue = HeapQueue;	// fastest with a handful of devices
+    schedPolicy = RoundRobinPolicy;
+    handOff = FALSE;
+    replacePolicy = ClockReplace;
+    numFrames = NumPhysPages;
     consoleIn = NULL;          // default is stdin
     consoleOut = NULL;         // default is stdout
 #ifndef FILESYS_STUB
@@ -36,6 +48,7 @@ Kernel::Kernel(int argc, char **argv)
     reliability = 1;            // network reliability, default is 1.0
     hostName = 0;               // machine id, also UNIX socket name
                                 // 0 is the default machine id
+    farmed = FALSE;		// set by main for -farm
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-rs") == 0) {
  	    ASSERT(i + 1 < argc);
@@ -43,8 +56,76 @@ Kernel::Kernel(int argc, char **argv)
 					// number generator
 	    randomSlice = TRUE;
 	    i++;
+        } else if (strcmp(argv[i], "-quantum") == 0) {
+            ASSERT(i + 1 < argc);   // next argument is int
+            quantum = atoi(argv[i + 1]);
+            ASSERT(quantum > 0);
+            i++;
+        } else if (strcmp(argv[i], "-aq") == 0) {
+            adaptiveQuantum = TRUE;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
+        } else if (strcmp(argv[i], "-bt") == 0) {
+            translateBlocks = TRUE;
+        } else if (strcmp(argv[i], "-ot") == 0) {
+            batchTicks = FALSE;
+        } else if (strcmp(argv[i], "-ntc") == 0) {
+            cacheTranslations = FALSE;
+        } else if (strcmp(argv[i], "-cpus") == 0) {
+            ASSERT(i + 1 < argc);   // next argument is int
+            numCPUs = atoi(argv[i + 1]);
+            ASSERT((numCPUs >= 1) && (numCPUs <= MaxCPUs));
+            i++;
+        } else if (strcmp(argv[i], "-eq") == 0) {
+            ASSERT(i + 1 < argc);   // next argument is queue type
+            if (strcmp(argv[i + 1], "list") == 0) {
+                eventQueue = ListQueue;
+            } else if (strcmp(argv[i + 1], "heap") == 0) {
+                eventQueue = HeapQueue;
+            } else {
+                ASSERT(strcmp(argv[i + 1], "wheel") == 0);
+                eventQueue = WheelQueue;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-sched") == 0) {
+            ASSERT(i + 1 < argc);   // next argument is policy
+            if (strcmp(argv[i + 1], "rr") == 0) {
+                schedPolicy = RoundRobinPolicy;
+            } else if (strcmp(argv[i + 1], "prio") == 0) {
+                schedPolicy = PriorityPolicy;
+            } else if (strcmp(argv[i + 1], "mlfq") == 0) {
+                schedPolicy = FeedbackPolicy;
+            } else if (strcmp(argv[i + 1], "lottery") == 0) {
+                schedPolicy = LotteryPolicy;
+            } else {
+                ASSERT(strcmp(argv[i + 1], "stride") == 0);
+                schedPolicy = StridePolicy;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-handoff") == 0) {
+            handOff = TRUE;
+        } else if (strcmp(argv[i], "-rp") == 0) {
+            ASSERT(i + 1 < argc);   // next argument is policy
+            if (strcmp(argv[i + 1], "fifo") == 0) {
+                replacePolicy = FifoReplace;
+            } else if (strcmp(argv[i + 1], "clock") == 0) {
+                replacePolicy = ClockReplace;
+            } else if (strcmp(argv[i + 1], "eclock") == 0) {
+                replacePolicy = EnhancedClockReplace;
+            } else {
+                ASSERT(strcmp(argv[i + 1], "lru") == 0);
+                replacePolicy = LruReplace;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-frames") == 0) {
+            ASSERT(i + 1 < argc);   // next argument is int
+            numFrames = atoi(argv[i + 1]);
+            ASSERT((numFrames >= 1) && (numFrames <= NumPhysPages));
+            i++;
+        } else if (strcmp(argv[i], "-prof") == 0) {
+            ASSERT(i + 1 < argc);   // next argument is file name
+            profileFile = argv[i + 1];
+            i++;
 	} else if (strcmp(argv[i], "-ci") == 0) {
 	    ASSERT(i + 1 < argc);
 	    consoleIn = argv[i + 1];
@@ -67,7 +148,12 @@ Kernel::Kernel(int argc, char **argv)
             i++;
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
-	    cout << "Partial usage: nachos [-s]\n";
+	    cout << "Partial usage: nachos [-quantum #] [-aq]\n";
+	    cout << "Partial usage: nachos [-s] [-bt] [-ot] [-ntc] [-cpus #]\n";
+	    cout << "Partial usage: nachos [-prof profileFile]\n";
+	    cout << "Partial usage: nachos [-eq list|heap|wheel]\n";
+	    cout << "Partial usage: nachos [-sched rr|prio|mlfq|lottery|stride] [-handoff]\n";
+	    cout << "Partial usage: nachos [-rp fifo|clock|eclock|lru] [-frames #]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
 	    cout << "Partial usage: nachos [-nf]\n";
@@ -94,15 +180,19 @@ Kernel::Initialize()
     currentThread->setStatus(RUNNING);
 
     stats = new Statistics();		// collect statistics
-    interrupt = new Interrupt;		// start up interrupt handling
-    scheduler = new Scheduler();	// initialize the ready queue
-    alarm = new Alarm(randomSlice);	// start up time slicing
-    machine = new Machine(debugUserProg);
+    interrupt = new Interrupt(eventQueue, numCPUs);
+    					// start up interrupt handling
+    scheduler = new Scheduler(numCPUs, schedPolicy, handOff);
+    					// initialize the ready queue
+    alarm = new Alarm(randomSlice, numCPUs, quantum, adaptiveQuantum);
+    					// start up time slicing
+    machine = new Machine(debugUserProg, translateBlocks, batchTicks,
+				cacheTranslations, numCPUs, profileFile);
     synchConsoleIn = new SynchConsoleInput(consoleIn); // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut); // output to stdout
     synchDisk = new SynchDisk();    //
     procmgr = new ProcessManager();
-    memmgr = new MemoryManager();
+    memmgr = new MemoryManager(replacePolicy, numFrames);
     diskBuffer = new char[PageSize];
 #ifdef FILESYS_STUB
     fileSystem = new FileSystem();
@@ -137,7 +227,10 @@ Kernel::~Kernel()
     delete postOfficeIn;
     delete postOfficeOut;
     
-    Exit(0);
+    if (farmed)
+	FarmMachineHalted();	// stop just this machine (see main.cc)
+    else
+	Exit(0);
 }
 
 //----------------------------------------------------------------------
@@ -165,6 +258,8 @@ Kernel::ThreadSelfTest() {
    synchList->SelfTest(9);
    delete synchList;
 
+   alarm->SelfTest();		// test sleeping
+
    ElevatorTest();
 }
 
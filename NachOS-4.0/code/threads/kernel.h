@@ -63,10 +63,28 @@ class Kernel {
     PostOfficeOutput *postOfficeOut;
 
     int hostName;               // machine identifier
+    bool farmed;		// one of several machines in this process?
 
   private:
     bool randomSlice;		// enable pseudo-random time slicing
+    int quantum;		// the time slice, in ticks
+    bool adaptiveQuantum;	// adapt the time slice to each thread
     bool debugUserProg;         // single step user program
+    bool translateBlocks;	// run user programs with the basic-block
+				// translation engine
+    bool batchTicks;		// charge user ticks in bulk, up to the
+				// next pending interrupt
+    bool cacheTranslations;	// cache the last page table translation
+				// for fetches, loads and stores
+    int numCPUs;		// # of simulated CPUs sharing memory
+    char *profileFile;		// where to write the user code profile,
+				// or NULL not to profile
+    EventQueueType eventQueue;	// how to keep pending interrupts in order
+    SchedPolicyType schedPolicy;// how to choose the next thread to run
+    bool handOff;		// run a thread woken by a V (or Signal)
+				// next, ahead of the ready list
+    ReplacePolicyType replacePolicy;// how to choose a page to evict
+    int numFrames;		// # of physical pages for user programs
     double reliability;         // likelihood messages are dropped
     char *consoleIn;            // file to read console input from
     char *consoleOut;           // file to send console output to
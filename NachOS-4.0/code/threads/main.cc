@@ -2,18 +2,54 @@
 //	Driver code to initialize, selftest, and run the 
 //	operating system kernel.  
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
-//              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
+// Usage: nachos -d <debugflags> -rs <random seed #> -quantum <ticks> -aq
+//              -s -bt -ot -ntc -cpus <# of CPUs> -prof <profile file>
+//              -eq <list|heap|wheel> -sched <rr|prio|mlfq|lottery|stride>
+//              -handoff -rp <fifo|clock|eclock|lru> -frames <# of pages>
+//              -x <nachos file> -ci <consoleIn> -co <consoleOut>
+//              -snap <snapshot file> <tick> -restore <snapshot file>
 //              -f -cp <unix file> <nachos file>
 //              -p <nachos file> -r <nachos file> -l -D
 //              -n <network reliability> -m <machine id>
-//              -z -K -C -N
+//              -z -K -C -N -M -Q -T -L -farm <# of machines>
 //
 //    -d causes certain debugging messages to be printed (see debug.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -quantum sets the time slice (TimerTicks by default)
+//    -aq adapts the time slice to each thread: longer for CPU-bound
+//	threads, shorter for ones that mostly wait (see alarm.h)
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
+//    -bt runs user programs a basic block at a time, using translated
+//	code, rather than with the instruction-at-a-time interpreter
+//    -ot charges a tick after every user instruction, rather than in
+//	bulk up to the next pending interrupt (for checking that the
+//	two give the same results; see "make check-ticks")
+//    -ntc turns off the machine's cache of recent address translations
+//	(see "make bench-translate")
+//    -cpus simulates several CPUs sharing memory, interleaving their
+//	user instructions (-bt and bulk ticks don't apply); kernel code
+//	still runs on one CPU at a time
+//    -prof profiles user programs: the instruction mix and the hottest
+//	instructions and basic blocks are printed when Nachos halts, and
+//	all the counts are written to the file (see profiler.h)
+//    -eq picks how pending interrupts are kept in order: a sorted
+//	list, a binary heap (the default) or a timing wheel (see
+//	eventqueue.h, and "make bench-eventq")
+//    -sched picks the scheduling policy: round robin (the default),
+//	priority, a multilevel feedback queue, lottery or stride
+//	scheduling (see schedpolicy.h)
+//    -handoff runs a thread woken up by a semaphore V (or a condition
+//	Signal) next, ahead of the other ready threads (see scheduler.h)
+//    -rp picks the page replacement policy: FIFO, the clock (the
+//	default), the clock preferring clean pages, or approximate LRU
+//	(see memmgr.h, and "make bench-paging")
+//    -frames limits the physical pages used for user programs
 //    -x runs a user program
+//    -snap saves the state of the machine to the file at the given
+//	tick (or as soon after as it is quiet), then carries on
+//    -restore runs the user program saved in a snapshot, from where
+//	it was saved, instead of one given by -x (see snapshot.h)
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
 //    -n sets the network reliability
@@ -21,6 +57,13 @@
 //    -K run a simple self test of kernel threads and synchronization
 //    -C run an interactive console test
 //    -N run a two-machine network test (see Kernel::NetworkTest)
+//    -M run a self test of the simulated multiply and divide
+//    -Q time the kinds of event queue against each other
+//    -T time forking threads with and without stack pools (see stackpool.h)
+//    -L time ping-ponging between two threads with and without -handoff
+//    -farm runs several independent machines in this process, each on
+//	its own host thread and with its own host id (overriding -m);
+//	each runs the rest of the command line (see RunFarm)
 //
 //    Filesystem-related flags:
 //    -f forces the Nachos disk to be formatted
@@ -45,9 +88,15 @@
 #include "filesys.h"
 #include "openfile.h"
 #include "sysdep.h"
+#include "snapshot.h"
+#include "stackpool.h"
+#include "synch.h"
+
+#include <pthread.h>
+#include <signal.h>
 
 // global variables
-Kernel *kernel;
+__thread Kernel *kernel;	// the machine run by this host thread
 Debug *debug;
 
 
@@ -61,6 +110,8 @@ Cleanup(int x)
 {     
     cerr << "\nCleaning up after signal " << x << "\n";
     delete kernel; 
+    Exit(0);		// only reached in farm mode, where the main 
+			// host thread has no kernel of its own
 }
 
 //-------------------------------------------------------------------
@@ -149,6 +200,209 @@ Print(char *name)
 
 
 
+// Command line flags handled by main, rather than by the Kernel
+// constructor.  In farm mode every machine reads these, so they
+// are not changed once the machines start up.
+
+static char *userProgName = NULL;	// default is not to execute a user prog
+static char *snapFileName = NULL;	// default is not to take a snapshot
+static int snapTick = 0;		// when to take it
+static char *restoreFileName = NULL;	// snapshot to run, if any
+static bool threadTestFlag = false;
+static bool consoleTestFlag = false;
+static bool networkTestFlag = false;
+static bool multDivTestFlag = false;
+static bool eventQueueBenchFlag = false;
+static bool threadBenchFlag = false;
+static bool pingPongBenchFlag = false;
+#ifndef FILESYS_STUB
+static char *copyUnixFileName = NULL;	// UNIX file to be copied into Nachos
+static char *copyNachosFileName = NULL;	// name of copied file in Nachos
+static char *printFileName = NULL; 
+static char *removeFileName = NULL;
+static bool dirListFlag = false;
+static bool dumpFlag = false;
+#endif //FILESYS_STUB
+
+//----------------------------------------------------------------------
+// RunKernel
+// 	Boot one Nachos machine on the calling host thread: initialize
+//	its kernel, run the requested tests and initial user program,
+//	then halt.  Never returns.
+//
+//	"argc", "argv" -- the command line, for the Kernel constructor
+//	"farmed" -- TRUE if this is one of several machines in a test
+//		farm, in which case halting only stops this machine
+//----------------------------------------------------------------------
+
+static void
+RunKernel(int argc, char **argv, bool farmed)
+{
+    kernel = new Kernel(argc, argv);
+    kernel->farmed = farmed;
+
+    kernel->Initialize();
+
+    if (!farmed)
+	CallOnUserAbort(Cleanup);	// if user hits ctl-C
+
+    // at this point, the kernel is ready to do something
+    // run some tests, if requested
+    if (threadTestFlag) {
+      kernel->ThreadSelfTest();  // test threads and synchronization
+    }
+    if (consoleTestFlag) {
+      kernel->ConsoleTest();   // interactive test of the synchronized console
+    }
+    if (networkTestFlag) {
+      kernel->NetworkTest();   // two-machine test of the network
+    }
+    if (multDivTestFlag) {
+      MultDivSelfTest();       // check multiply/divide against reference
+    }
+    if (eventQueueBenchFlag) {
+      EventQueueBenchmark();   // time the event queues on millions of events
+    }
+    if (threadBenchFlag) {
+      ThreadBenchmark();       // time forking and destroying threads
+    }
+    if (pingPongBenchFlag) {
+      PingPongBenchmark();     // time waking threads, with and without handoff
+    }
+
+#ifndef FILESYS_STUB
+    if (removeFileName != NULL) {
+      kernel->fileSystem->Remove(removeFileName);
+    }
+    if (copyUnixFileName != NULL && copyNachosFileName != NULL) {
+      Copy(copyUnixFileName,copyNachosFileName);
+    }
+    if (dumpFlag) {
+      kernel->fileSystem->Print();
+    }
+    if (dirListFlag) {
+      kernel->fileSystem->List();
+    }
+    if (printFileName != NULL) {
+      Print(printFileName);
+    }
+#endif // FILESYS_STUB
+
+    if (snapFileName != NULL) {
+      new Snapshot(snapFileName, snapTick);
+    }
+
+    // finally, run an initial user program if requested to do so
+    if (restoreFileName != NULL) {
+      RestoreSnapshot(restoreFileName);	// never returns
+    }
+    if (userProgName != NULL) {
+      AddrSpace *space = new AddrSpace;
+      ASSERT(space != (AddrSpace *)NULL);
+      if (space->Load(userProgName) == 0) {  // load the program into the space
+	space->Execute();              // run the program
+	ASSERTNOTREACHED();            // Execute never returns
+      }
+    }
+
+    // If we don't run a user program, we may get here.
+    // Calling "return" would terminate the program.
+    // Instead, call Halt, which will first clean up, then
+    //  terminate.
+    kernel->interrupt->Halt();
+    
+    ASSERTNOTREACHED();
+}
+
+//----------------------------------------------------------------------
+// Test farms (-farm)
+//	Several independent machines -- each with its own kernel, memory,
+//	interrupts, scheduler and devices -- in one UNIX process, each
+//	on its own host thread.  "kernel" is thread-local, so all of the
+//	code that refers to it finds the machine running on its own
+//	host thread.  Nachos threads only ever switch among the threads
+//	of their own machine, on the same host thread.
+//
+//	Machine i gets host id i (as if started with "-m i"), so each
+//	has its own disk, console and network socket files.
+//
+//	When a machine halts, its host thread parks itself; once all
+//	of them have halted, the main host thread exits the process.
+//----------------------------------------------------------------------
+
+static int farmRunning;			// # of machines yet to halt
+static pthread_mutex_t farmLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t farmChanged = PTHREAD_COND_INITIALIZER;
+static int farmArgc;			// command line for each machine
+
+static void *
+FarmMachine(void *arg)
+{
+    sigset_t sigs;
+
+    sigemptyset(&sigs);			// let the main host thread 
+    sigaddset(&sigs, SIGINT);		// field ctl-C
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+
+    RunKernel(farmArgc, (char **) arg, TRUE);
+    return NULL;			// not reached
+}
+
+//----------------------------------------------------------------------
+// FarmMachineHalted
+// 	Called by ~Kernel, in place of exiting, when a machine of a test
+//	farm halts.  Never returns.
+//----------------------------------------------------------------------
+
+void
+FarmMachineHalted()
+{
+    pthread_mutex_lock(&farmLock);
+    farmRunning--;
+    pthread_cond_broadcast(&farmChanged);
+    for (;;)				// wait for the process to exit
+	pthread_cond_wait(&farmChanged, &farmLock);
+}
+
+//----------------------------------------------------------------------
+// RunFarm
+// 	Start "size" machines, each with a copy of the command line plus
+//	its own host id, and wait for all of them to halt.
+//----------------------------------------------------------------------
+
+static void
+RunFarm(int size, int argc, char **argv)
+{
+    pthread_t tid;
+    char **machineArgv;
+    char *id;
+
+    CallOnUserAbort(Cleanup);		// if user hits ctl-C
+    farmArgc = argc + 2;
+    farmRunning = size;
+    for (int i = 0; i < size; i++) {
+	machineArgv = new char *[farmArgc + 1];
+	for (int j = 0; j < argc; j++)
+	    machineArgv[j] = argv[j];
+	id = new char[16];
+	sprintf(id, "%d", i);
+	machineArgv[argc] = "-m";
+	machineArgv[argc + 1] = id;
+	machineArgv[argc + 2] = NULL;
+	if (pthread_create(&tid, NULL, FarmMachine, machineArgv) != 0) {
+	    cerr << "Unable to start farm machine " << i << "\n";
+	    Exit(1);
+	}
+    }
+
+    pthread_mutex_lock(&farmLock);
+    while (farmRunning > 0)
+	pthread_cond_wait(&farmChanged, &farmLock);
+    pthread_mutex_unlock(&farmLock);
+    cout << "Farm: all " << size << " machines halted\n";
+    Exit(0);
+}
+
 //----------------------------------------------------------------------
 // main
 // 	Bootstrap the operating system kernel.  
@@ -168,18 +422,7 @@ main(int argc, char **argv)
 {
     int i;
     char *debugArg = "";
-    char *userProgName = NULL;        // default is not to execute a user prog
-    bool threadTestFlag = false;
-    bool consoleTestFlag = false;
-    bool networkTestFlag = false;
-#ifndef FILESYS_STUB
-    char *copyUnixFileName = NULL;    // UNIX file to be copied into Nachos
-    char *copyNachosFileName = NULL;  // name of copied file in Nachos
-    char *printFileName = NULL; 
-    char *removeFileName = NULL;
-    bool dirListFlag = false;
-    bool dumpFlag = false;
-#endif //FILESYS_STUB
+    int farmSize = 0;			// default is a single machine
 
     // some command line arguments are handled here.
     // those that set kernel parameters are handled in
@@ -198,6 +441,17 @@ main(int argc, char **argv)
 	    userProgName = argv[i + 1];
 	    i++;
 	}
+	else if (strcmp(argv[i], "-snap") == 0) {
+	    ASSERT(i + 2 < argc);
+	    snapFileName = argv[i + 1];
+	    snapTick = atoi(argv[i + 2]);
+	    i += 2;
+	}
+	else if (strcmp(argv[i], "-restore") == 0) {
+	    ASSERT(i + 1 < argc);
+	    restoreFileName = argv[i + 1];
+	    i++;
+	}
 	else if (strcmp(argv[i], "-K") == 0) {
 	    threadTestFlag = TRUE;
 	}
@@ -207,6 +461,24 @@ main(int argc, char **argv)
 	else if (strcmp(argv[i], "-N") == 0) {
 	    networkTestFlag = TRUE;
 	}
+	else if (strcmp(argv[i], "-M") == 0) {
+	    multDivTestFlag = TRUE;
+	}
+	else if (strcmp(argv[i], "-Q") == 0) {
+	    eventQueueBenchFlag = TRUE;
+	}
+	else if (strcmp(argv[i], "-T") == 0) {
+	    threadBenchFlag = TRUE;
+	}
+	else if (strcmp(argv[i], "-L") == 0) {
+	    pingPongBenchFlag = TRUE;
+	}
+	else if (strcmp(argv[i], "-farm") == 0) {
+	    ASSERT(i + 1 < argc);   // next argument is # of machines
+	    farmSize = atoi(argv[i + 1]);
+	    ASSERT(farmSize > 0);
+	    i++;
+	}
 #ifndef FILESYS_STUB
 	else if (strcmp(argv[i], "-cp") == 0) {
 	    ASSERT(i + 2 < argc);
@@ -234,7 +506,9 @@ main(int argc, char **argv)
 	else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-z -d debugFlags]\n";
             cout << "Partial usage: nachos [-x programName]\n";
-	    cout << "Partial usage: nachos [-K] [-C] [-N]\n";
+            cout << "Partial usage: nachos [-snap fileName tick] [-restore fileName]\n";
+	    cout << "Partial usage: nachos [-K] [-C] [-N] [-M] [-Q] [-T] [-L]\n";
+	    cout << "Partial usage: nachos [-farm #]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-cp UnixFile NachosFile]\n";
             cout << "Partial usage: nachos [-p fileName] [-r fileName]\n";
@@ -247,58 +521,10 @@ main(int argc, char **argv)
     
     DEBUG(dbgThread, "Entering main");
 
-    kernel = new Kernel(argc, argv);
-
-    kernel->Initialize();
-
-    CallOnUserAbort(Cleanup);		// if user hits ctl-C
+    if (farmSize > 0)
+	RunFarm(farmSize, argc, argv);
+    else
+	RunKernel(argc, argv, FALSE);
 
-    // at this point, the kernel is ready to do something
-    // run some tests, if requested
-    if (threadTestFlag) {
-      kernel->ThreadSelfTest();  // test threads and synchronization
-    }
-    if (consoleTestFlag) {
-      kernel->ConsoleTest();   // interactive test of the synchronized console
-    }
-    if (networkTestFlag) {
-      kernel->NetworkTest();   // two-machine test of the network
-    }
-
-#ifndef FILESYS_STUB
-    if (removeFileName != NULL) {
-      kernel->fileSystem->Remove(removeFileName);
-    }
-    if (copyUnixFileName != NULL && copyNachosFileName != NULL) {
-      Copy(copyUnixFileName,copyNachosFileName);
-    }
-    if (dumpFlag) {
-      kernel->fileSystem->Print();
-    }
-    if (dirListFlag) {
-      kernel->fileSystem->List();
-    }
-    if (printFileName != NULL) {
-      Print(printFileName);
-    }
-#endif // FILESYS_STUB
-
-    // finally, run an initial user program if requested to do so
-    if (userProgName != NULL) {
-      AddrSpace *space = new AddrSpace;
-      ASSERT(space != (AddrSpace *)NULL);
-      if (space->Load(userProgName)) {  // load the program into the space
-	space->Execute();              // run the program
-	ASSERTNOTREACHED();            // Execute never returns
-      }
-    }
-
-    // If we don't run a user program, we may get here.
-    // Calling "return" would terminate the program.
-    // Instead, call Halt, which will first clean up, then
-    //  terminate.
-    kernel->interrupt->Halt();
-    
     ASSERTNOTREACHED();
 }
-
@@ -12,8 +12,12 @@
 #include "debug.h"
 #include "kernel.h"
 
-extern Kernel *kernel;
+extern __thread Kernel *kernel;	// thread-local, so that several
+					// machines can share the process
+					// (see "-farm" in main.cc)
 extern Debug *debug;
 
+extern void FarmMachineHalted();	// a farm machine has halted
+
 #endif // MAIN_H
 
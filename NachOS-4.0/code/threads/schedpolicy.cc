@@ -0,0 +1,334 @@
+// schedpolicy.cc
+//	Routines to keep track of the threads that are ready to run,
+//	and to pick which of them runs next, under each of the
+//	scheduling policies (see schedpolicy.h).
+//
+// 	These routines assume that interrupts are already disabled
+//	(they are only called by the scheduler).
+
+#include "debug.h"
+#include "schedpolicy.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// NewSchedPolicy
+// 	Make a new scheduling policy of the given kind.
+//----------------------------------------------------------------------
+
+SchedPolicy *
+NewSchedPolicy(SchedPolicyType type)
+{
+    switch (type) {
+      case RoundRobinPolicy:
+	return new RoundRobinSchedPolicy;
+      case PriorityPolicy:
+	return new PrioritySchedPolicy;
+      case FeedbackPolicy:
+	return new FeedbackSchedPolicy;
+      case LotteryPolicy:
+	return new LotterySchedPolicy;
+      case StridePolicy:
+	return new StrideSchedPolicy;
+    }
+    ASSERTNOTREACHED();
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// RoundRobinSchedPolicy::Add, Next
+// 	Threads run in the order they became ready.
+//----------------------------------------------------------------------
+
+void
+RoundRobinSchedPolicy::Add(Thread *thread)
+{
+    queue->Append(thread);
+    numReady++;
+}
+
+Thread *
+RoundRobinSchedPolicy::Next()
+{
+    if (queue->IsEmpty())
+	return NULL;
+    numReady--;
+    return queue->RemoveFront();
+}
+
+//----------------------------------------------------------------------
+// PrioritySchedPolicy::PrioritySchedPolicy
+// 	Initialize an empty queue for each priority.
+//----------------------------------------------------------------------
+
+PrioritySchedPolicy::PrioritySchedPolicy()
+{
+    for (int p = 0; p < NumPriorities; p++)
+	queues[p] = new ThreadQueue;
+}
+
+PrioritySchedPolicy::~PrioritySchedPolicy()
+{
+    for (int p = 0; p < NumPriorities; p++)
+	delete queues[p];
+}
+
+//----------------------------------------------------------------------
+// PrioritySchedPolicy::Add, Next, Apply
+// 	The highest priority ready thread runs next; threads of the
+//	same priority take turns.
+//----------------------------------------------------------------------
+
+void
+PrioritySchedPolicy::Add(Thread *thread)
+{
+    queues[thread->getPriority()]->Append(thread);
+    numReady++;
+}
+
+Thread *
+PrioritySchedPolicy::Next()
+{
+    for (int p = NumPriorities - 1; p >= 0; p--) {
+	if (!queues[p]->IsEmpty()) {
+	    numReady--;
+	    return queues[p]->RemoveFront();
+	}
+    }
+    return NULL;
+}
+
+void
+PrioritySchedPolicy::Apply(void (*func)(Thread *))
+{
+    for (int p = NumPriorities - 1; p >= 0; p--)
+	queues[p]->Apply(func);
+}
+
+//----------------------------------------------------------------------
+// PrioritySchedPolicy::Preempts
+// 	A thread takes the CPU from any of lower priority.
+//----------------------------------------------------------------------
+
+bool
+PrioritySchedPolicy::Preempts(Thread *ready, Thread *running)
+{
+    return ready->getPriority() > running->getPriority();
+}
+
+//----------------------------------------------------------------------
+// FeedbackSchedPolicy::FeedbackSchedPolicy
+// 	Initialize an empty queue for each level.
+//----------------------------------------------------------------------
+
+FeedbackSchedPolicy::FeedbackSchedPolicy()
+{
+    for (int level = 0; level < FeedbackLevels; level++)
+	queues[level] = new ThreadQueue;
+    lastBoost = 0;
+    boostGeneration = 0;
+}
+
+FeedbackSchedPolicy::~FeedbackSchedPolicy()
+{
+    for (int level = 0; level < FeedbackLevels; level++)
+	delete queues[level];
+}
+
+//----------------------------------------------------------------------
+// FeedbackSchedPolicy::Boost
+// 	If all threads have been moved back to the top level since
+//	"thread" was last looked at, move it there too.  (Running and
+//	blocked threads are brought up to date lazily, like this, when
+//	they are next charged or made ready.)
+//----------------------------------------------------------------------
+
+void
+FeedbackSchedPolicy::Boost(Thread *thread)
+{
+    if (thread->schedGeneration != boostGeneration) {
+	thread->schedGeneration = boostGeneration;
+	thread->schedLevel = 0;
+	thread->schedUsed = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// FeedbackSchedPolicy::Add
+// 	Put "thread" at the back of the queue for its level.
+//----------------------------------------------------------------------
+
+void
+FeedbackSchedPolicy::Add(Thread *thread)
+{
+    Boost(thread);
+    queues[thread->schedLevel]->Append(thread);
+    numReady++;
+}
+
+//----------------------------------------------------------------------
+// FeedbackSchedPolicy::Next
+// 	Return the first thread on the highest level that has any.
+//	If it is time, first move every ready thread back to the top.
+//----------------------------------------------------------------------
+
+Thread *
+FeedbackSchedPolicy::Next()
+{
+    int now = kernel->stats->totalTicks;
+
+    if (now - lastBoost >= BoostSlices * kernel->alarm->Quantum()) {
+	DEBUG(dbgThread, "Moving all threads to the top level");
+	lastBoost = now;
+	boostGeneration++;
+	for (int level = 1; level < FeedbackLevels; level++) {
+	    while (!queues[level]->IsEmpty()) {
+		Thread *thread = queues[level]->RemoveFront();
+		Boost(thread);
+		queues[0]->Append(thread);
+	    }
+	}
+    }
+    for (int level = 0; level < FeedbackLevels; level++) {
+	if (!queues[level]->IsEmpty()) {
+	    numReady--;
+	    return queues[level]->RemoveFront();
+	}
+    }
+    return NULL;
+}
+
+void
+FeedbackSchedPolicy::Apply(void (*func)(Thread *))
+{
+    for (int level = 0; level < FeedbackLevels; level++)
+	queues[level]->Apply(func);
+}
+
+//----------------------------------------------------------------------
+// FeedbackSchedPolicy::Charge
+// 	Count the CPU time "thread" has used on its level; once that
+//	comes to its allotment, move it down a level.  Time is counted
+//	across time slices, so a thread can't stay on a level by
+//	giving up the CPU just before the timer goes off.
+//----------------------------------------------------------------------
+
+void
+FeedbackSchedPolicy::Charge(Thread *thread, int ticks)
+{
+    Boost(thread);
+    thread->schedUsed += ticks;
+    if ((thread->schedUsed >= (kernel->alarm->Quantum() << thread->schedLevel))
+			&& (thread->schedLevel < FeedbackLevels - 1)) {
+	thread->schedLevel++;
+	thread->schedUsed = 0;
+	DEBUG(dbgThread, "Moving " << thread->getName() << " down to level "
+						<< thread->schedLevel);
+    }
+}
+
+//----------------------------------------------------------------------
+// FeedbackSchedPolicy::Preempts
+// 	A thread takes the CPU from any on a lower level.
+//----------------------------------------------------------------------
+
+bool
+FeedbackSchedPolicy::Preempts(Thread *ready, Thread *running)
+{
+    Boost(running);
+    return ready->schedLevel < running->schedLevel;
+}
+
+//----------------------------------------------------------------------
+// LotterySchedPolicy::Add
+// 	"thread" joins the draw, with its tickets.
+//----------------------------------------------------------------------
+
+void
+LotterySchedPolicy::Add(Thread *thread)
+{
+    queue->Append(thread);
+    numReady++;
+}
+
+//----------------------------------------------------------------------
+// LotterySchedPolicy::Next
+// 	Draw a winning ticket, and return the thread holding it.  The
+//	tickets are counted afresh each time, in case a priority has
+//	changed.
+//----------------------------------------------------------------------
+
+Thread *
+LotterySchedPolicy::Next()
+{
+    Thread *thread;
+    int totalTickets = 0, winner;
+
+    if (queue->IsEmpty())
+	return NULL;
+    for (thread = queue->Front(); thread != NULL; thread = queue->Next(thread))
+	totalTickets += thread->getTickets();
+    winner = RandomNumber() % totalTickets;
+    for (thread = queue->Front(); thread != NULL; thread = queue->Next(thread)) {
+	winner -= thread->getTickets();
+	if (winner < 0)
+	    break;
+    }
+    ASSERT(thread != NULL);
+    queue->Remove(thread);
+    numReady--;
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// StrideSchedPolicy::Add
+// 	Put "thread" in order of pass, after any with the same pass.
+//	A thread that has been blocked doesn't get to catch up on the
+//	CPU time it missed: it comes back no further behind than the
+//	thread that last ran.
+//----------------------------------------------------------------------
+
+void
+StrideSchedPolicy::Add(Thread *thread)
+{
+    Thread *after;
+
+    if (thread->schedPass < globalPass)
+	thread->schedPass = globalPass;
+    for (after = queue->Front(); after != NULL; after = queue->Next(after)) {
+	if (thread->schedPass < after->schedPass)
+	    break;
+    }
+    queue->InsertBefore(thread, after);
+    numReady++;
+}
+
+//----------------------------------------------------------------------
+// StrideSchedPolicy::Next
+// 	Return the thread with the lowest pass.
+//----------------------------------------------------------------------
+
+Thread *
+StrideSchedPolicy::Next()
+{
+    Thread *thread;
+
+    if (queue->IsEmpty())
+	return NULL;
+    thread = queue->RemoveFront();
+    globalPass = thread->schedPass;
+    numReady--;
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// StrideSchedPolicy::Charge
+// 	Advance the pass of "thread" by its stride for each time slice
+//	worth of CPU time it has had.
+//----------------------------------------------------------------------
+
+void
+StrideSchedPolicy::Charge(Thread *thread, int ticks)
+{
+    thread->schedPass += (long long) (StrideScale / thread->getTickets())
+					* ticks / kernel->alarm->Quantum();
+}
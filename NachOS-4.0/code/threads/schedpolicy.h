@@ -0,0 +1,168 @@
+// schedpolicy.h
+//	Data structures for the scheduling policies: the rules the
+//	scheduler uses to pick which ready thread runs next.  There are
+//	several interchangeable policies (picked with -sched):
+//
+//	  RoundRobinPolicy -- the original single FIFO queue; each thread
+//		runs until it blocks or its time slice is up.
+//	  PriorityPolicy -- always run the ready thread with the highest
+//		priority, FIFO among equals.  A thread that becomes ready
+//		pre-empts a lower priority one at the end of the interrupt
+//		that woke it.
+//	  FeedbackPolicy -- a multilevel feedback queue.  Threads start
+//		on the top level; one that uses up its allotment of CPU
+//		time on a level (whether in one time slice or many) moves
+//		down a level, and every so often all move back to the top,
+//		so that nothing starves.  Threads that mostly wait (for
+//		the console, say) stay on the top level, ahead of
+//		CPU-bound ones, and pre-empt them when they wake up.
+//	  LotteryPolicy -- each ready thread holds tickets in proportion
+//		to its priority, and a random draw picks the next to run.
+//	  StridePolicy -- the deterministic version of lottery
+//		scheduling: each thread runs in proportion to its tickets,
+//		by always picking the one that has had least CPU time per
+//		ticket (its "pass").
+//
+//	The policies keep the ready threads on ThreadQueues, linked
+//	through the threads themselves, so making a thread ready never
+//	allocates memory.
+
+#ifndef SCHEDPOLICY_H
+#define SCHEDPOLICY_H
+
+#include "thread.h"
+
+// The kinds of scheduling policy.
+enum SchedPolicyType { RoundRobinPolicy, PriorityPolicy, FeedbackPolicy,
+		       LotteryPolicy, StridePolicy };
+
+// The following class defines the operations on the set of threads
+// that are ready to run.
+
+class SchedPolicy {
+  public:
+    SchedPolicy() { numReady = 0; }
+    virtual ~SchedPolicy() {}
+
+    virtual void Add(Thread *thread) = 0;
+    				// "thread" is ready to run
+    virtual Thread *Next() = 0;	// Remove and return the thread to
+				// run next, NULL if none is ready
+    virtual void Apply(void (*func)(Thread *)) = 0;
+    				// Apply "func" to every ready thread
+
+    virtual void Charge(Thread *thread, int ticks) {}
+    				// "thread" has had the CPU for "ticks"
+    virtual bool Preempts(Thread *ready, Thread *running) { return FALSE; }
+    				// Should "ready" take the CPU from
+				// "running" straight away?
+
+    int NumReady() { return numReady; }
+    bool IsEmpty() { return (numReady == 0); }
+
+  protected:
+    int numReady;		// # of threads ready to run
+};
+
+// Make a new scheduling policy of the given kind, with no threads ready.
+extern SchedPolicy *NewSchedPolicy(SchedPolicyType type);
+
+// The original policy: first come, first served.
+
+class RoundRobinSchedPolicy : public SchedPolicy {
+  public:
+    RoundRobinSchedPolicy() { queue = new ThreadQueue; }
+    ~RoundRobinSchedPolicy() { delete queue; }
+
+    void Add(Thread *thread);
+    Thread *Next();
+    void Apply(void (*func)(Thread *)) { queue->Apply(func); }
+
+  private:
+    ThreadQueue *queue;		// the ready threads, in order of arrival
+};
+
+// Strict priority.
+
+class PrioritySchedPolicy : public SchedPolicy {
+  public:
+    PrioritySchedPolicy();
+    ~PrioritySchedPolicy();
+
+    void Add(Thread *thread);
+    Thread *Next();
+    void Apply(void (*func)(Thread *));
+    bool Preempts(Thread *ready, Thread *running);
+
+  private:
+    ThreadQueue *queues[NumPriorities];
+    				// the ready threads of each priority
+};
+
+// Multilevel feedback queue.  Level 0 is the top level; a thread's
+// allotment on level L is 2^L time slices.
+
+const int FeedbackLevels = 4;
+const int BoostSlices = 50;		// how often (in time slices) all
+					// threads move back to the top level
+
+class FeedbackSchedPolicy : public SchedPolicy {
+  public:
+    FeedbackSchedPolicy();
+    ~FeedbackSchedPolicy();
+
+    void Add(Thread *thread);
+    Thread *Next();
+    void Apply(void (*func)(Thread *));
+    void Charge(Thread *thread, int ticks);
+    bool Preempts(Thread *ready, Thread *running);
+
+  private:
+    ThreadQueue *queues[FeedbackLevels];
+    				// the ready threads on each level
+    int lastBoost;		// when all threads last moved to the top
+    int boostGeneration;	// # of boosts so far; a thread whose
+				// schedGeneration is older moves up
+
+    void Boost(Thread *thread);	// Bring "thread" up to date with boosts
+};
+
+// Lottery scheduling.
+
+class LotterySchedPolicy : public SchedPolicy {
+  public:
+    LotterySchedPolicy() { queue = new ThreadQueue; }
+    ~LotterySchedPolicy() { delete queue; }
+
+    void Add(Thread *thread);
+    Thread *Next();
+    void Apply(void (*func)(Thread *)) { queue->Apply(func); }
+
+  private:
+    ThreadQueue *queue;		// the ready threads, in no special order
+};
+
+// Stride scheduling.  The ready threads are kept in order of pass,
+// which goes up by the thread's stride for each time slice it runs.
+
+const int StrideScale = 1 << 16;	// a thread's stride is this divided
+					// by its tickets
+
+class StrideSchedPolicy : public SchedPolicy {
+  public:
+    StrideSchedPolicy() { queue = new ThreadQueue; globalPass = 0; }
+    ~StrideSchedPolicy() { delete queue; }
+
+    void Add(Thread *thread);
+    Thread *Next();
+    void Apply(void (*func)(Thread *)) { queue->Apply(func); }
+    void Charge(Thread *thread, int ticks);
+
+  private:
+    ThreadQueue *queue;		// the ready threads, lowest pass first
+    long long globalPass;	// the pass of the thread that last ran;
+				// a thread that has been blocked for a
+				// while starts again from here
+};
+
+#endif // SCHEDPOLICY_H
@@ -4,15 +4,16 @@
 //
 // 	These routines assume that interrupts are already disabled.
 //	If interrupts are disabled, we can assume mutual exclusion
-//	(since we are on a uniprocessor).
+//	(since we are on a uniprocessor -- or, with several simulated
+//	CPUs, since only one of them runs kernel code at a time).
 //
 // 	NOTE: We can't use Locks to provide mutual exclusion here, since
 // 	if we needed to wait for a lock, and the lock was busy, we would 
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	The choice of thread is left to a scheduling policy (see
+//	schedpolicy.h); by default, straight FIFO.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -26,13 +27,25 @@
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
 // 	Initialize the list of ready but not running threads.
-//	Initially, no ready threads.
+//	Initially, no ready threads, and only the current thread
+//	running, on CPU 0.
+//
+//	"nCPUs" is the number of simulated CPUs.
+//	"policyType" is how to choose which ready thread runs next.
+//	"doHandOff" -- if TRUE, a thread woken by a V runs next
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(int nCPUs, SchedPolicyType policyType, bool doHandOff)
 { 
-    readyList = new List<Thread *>; 
+    policy = NewSchedPolicy(policyType); 
+    handOff = doHandOff;
+    nextUp = NULL;
     toBeDestroyed = NULL;
+    numCPUs = nCPUs;
+    running[0] = kernel->currentThread;
+    running[0]->dispatchTick = kernel->stats->totalTicks;
+    for (int cpu = 1; cpu < numCPUs; cpu++)
+	running[cpu] = NULL;
 } 
 
 //----------------------------------------------------------------------
@@ -42,31 +55,148 @@ Scheduler::Scheduler()
 
 Scheduler::~Scheduler()
 { 
-    delete readyList; 
+    delete policy; 
 } 
 
+//----------------------------------------------------------------------
+// Scheduler::Charge
+// 	Tell the policy how much CPU time "thread", which is running,
+//	has had since it was dispatched or last charged.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Charge(Thread *thread)
+{
+    int now = kernel->stats->totalTicks;
+
+    policy->Charge(thread, now - thread->dispatchTick);
+    thread->dispatchTick = now;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Dispatch
+// 	Note that "thread" is being given a CPU: its CPU time counts
+//	from now, and its wait since it was made ready is over.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Dispatch(Thread *thread)
+{
+    Statistics *stats = kernel->stats;
+    int waited = stats->totalTicks - thread->readyTick;
+
+    thread->dispatchTick = stats->totalTicks;
+    thread->readyTicks += waited;
+    thread->numSwitches++;
+    stats->numContextSwitches++;
+    if (thread->yielded)
+	stats->yieldLatency.Record(waited);
+    else
+	stats->wakeupLatency.Record(waited);
+}
+
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
 //	Put it on the ready list, for later scheduling onto the CPU.
 //
+//	If the thread is running (it is yielding), first charge it for
+//	the CPU time it has had.  If it has just been woken up by an
+//	interrupt handler, and the policy says it should run ahead of
+//	the interrupted thread, switch to it once the handler is done.
+//
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
 
 void
 Scheduler::ReadyToRun (Thread *thread)
 {
-    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    Interrupt *interrupt = kernel->interrupt;
+    Thread *current = kernel->currentThread;
+    bool yielding = (thread->getStatus() == RUNNING);
+
+    ASSERT(interrupt->getLevel() == IntOff);
     DEBUG(dbgThread, "Putting thread on ready list: " << thread->getName());
 
+    if (yielding)
+	Charge(thread);
+    thread->readyTick = kernel->stats->totalTicks;
+    thread->yielded = yielding;
+    thread->setStatus(READY);
+    policy->Add(thread);
+    if (yielding)
+	return;
+    kernel->alarm->ThreadReady();	// something new to time-slice
+
+    if (interrupt->InHandler() && (interrupt->getStatus() != IdleMode)
+			&& (thread != current) && policy->Preempts(thread, current)) {
+	DEBUG(dbgThread, thread->getName() << " pre-empts " << current->getName());
+	interrupt->YieldOnReturn();
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::WakeUp
+// 	Called by Semaphore::V to make ready a thread that was waiting
+//	in P.  Normally the same as ReadyToRun; with handoff scheduling,
+//	the thread runs next, as soon as the current thread gives up
+//	the CPU.  (It doesn't pre-empt the current thread: the thread
+//	doing a V often has more to do -- releasing a lock, say --
+//	before it waits.)
+//
+//	If another woken thread was already due to run next, it has
+//	to take its turn on the ready list after all.
+//
+//	A V done by an interrupt handler (on console I/O completion,
+//	say) is not handed off: the thread goes through ReadyToRun, so
+//	that the policy can have it pre-empt the interrupted thread.
+//
+//	"thread" is the thread being woken up.
+//----------------------------------------------------------------------
+
+void
+Scheduler::WakeUp(Thread *thread)
+{
+    Interrupt *interrupt = kernel->interrupt;
+
+    ASSERT(interrupt->getLevel() == IntOff);
+
+    if (!handOff || (interrupt->InHandler()
+			&& (interrupt->getStatus() != IdleMode))) {
+	ReadyToRun(thread);
+	return;
+    }
+    DEBUG(dbgThread, "Handing off to: " << thread->getName());
+
+    if (nextUp != NULL)
+	policy->Add(nextUp);
+    thread->readyTick = kernel->stats->totalTicks;
+    thread->yielded = FALSE;
     thread->setStatus(READY);
-    readyList->Append(thread);
+    nextUp = thread;
+    kernel->alarm->ThreadReady();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Blocking
+// 	Called by Thread::Sleep when "thread", which is running, is
+//	about to block (or finish).  Charge it for the CPU time it has
+//	had, and let the alarm adapt its time slice.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Blocking(Thread *thread, bool finishing)
+{
+    if (!finishing)
+	kernel->alarm->ThreadBlocking(thread);
+    Charge(thread);
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
-// 	Return the next thread to be scheduled onto the CPU.
-//	If there are no ready threads, return NULL.
+// 	Return the next thread to be scheduled onto the CPU: one that
+//	has been handed the CPU by WakeUp, if any, or else the one the
+//	policy picks.  If there are no ready threads, return NULL.
 // Side effect:
 //	Thread is removed from the ready list.
 //----------------------------------------------------------------------
@@ -74,13 +204,14 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
+    Thread *thread = nextUp;
+
     ASSERT(kernel->interrupt->getLevel() == IntOff);
 
-    if (readyList->IsEmpty()) {
-	return NULL;
-    } else {
-    	return readyList->RemoveFront();
-    }
+    if (thread == NULL)
+	return policy->Next();
+    nextUp = NULL;
+    return thread;
 }
 
 //----------------------------------------------------------------------
@@ -122,6 +253,8 @@ Scheduler::Run (Thread *nextThread, bool finishing)
 
     kernel->currentThread = nextThread;  // switch to the next thread
     nextThread->setStatus(RUNNING);      // nextThread is now running
+    Dispatch(nextThread);
+    running[kernel->machine->CurrentCPU()] = nextThread;
     
     DEBUG(dbgThread, "Switching from: " << oldThread->getName() << " to: " << nextThread->getName());
     
@@ -149,6 +282,123 @@ Scheduler::Run (Thread *nextThread, bool finishing)
     }
 }
 
+//----------------------------------------------------------------------
+// Scheduler::IdleCPU
+// 	Called by Thread::Sleep when there is no ready thread to give
+//	the current CPU to.  If some other CPU is running a thread, leave
+//	this one idle and carry on simulating that one; otherwise return
+//	FALSE, as the whole machine is idle.
+//
+//	Like Run, we return (TRUE) once the current thread is woken up
+//	and dispatched again -- possibly on a different CPU.
+//
+//	"finishing" is set if the current thread is to be deleted
+//		(see Run).
+//----------------------------------------------------------------------
+
+bool
+Scheduler::IdleCPU(bool finishing)
+{
+    Thread *oldThread = kernel->currentThread;
+    Thread *nextThread = NULL;
+    int cpu = kernel->machine->CurrentCPU();
+    int next = cpu;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    for (int i = 1; (i < numCPUs) && (nextThread == NULL); i++) {
+	next = (cpu + i) % numCPUs;
+	nextThread = running[next];
+    }
+    if (nextThread == NULL)
+	return FALSE;
+
+    if (finishing) {
+         ASSERT(toBeDestroyed == NULL);
+	 toBeDestroyed = oldThread;
+    }
+    if (oldThread->space != NULL) {
+        oldThread->SaveUserState();
+	oldThread->space->SaveState();
+    }
+    oldThread->CheckOverflow();
+
+    DEBUG(dbgThread, "CPU " << cpu << " idle; switching to: " << nextThread->getName());
+
+    running[cpu] = NULL;
+    kernel->machine->SwitchCPU(next);
+    kernel->currentThread = nextThread;
+    SWITCH(oldThread, nextThread);
+
+    // we've been dispatched again, as in Run
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    CheckToBeDestroyed();
+    if (oldThread->space != NULL) {
+        oldThread->RestoreUserState();
+	oldThread->space->RestoreState();
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NextCPU
+// 	Return the CPU to simulate after the current one: the next one,
+//	round robin, that is running a thread, or that is idle but could
+//	be given a ready thread.  This is the current CPU if no other
+//	has anything to do.
+//----------------------------------------------------------------------
+
+int
+Scheduler::NextCPU()
+{
+    int cpu = kernel->machine->CurrentCPU();
+    int next;
+
+    for (int i = 1; i < numCPUs; i++) {
+	next = (cpu + i) % numCPUs;
+	if ((running[next] != NULL) || !NoneReady())
+	    return next;
+    }
+    return cpu;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SwitchToCPU
+// 	Carry on simulating "cpu", leaving the current thread running
+//	on the current CPU: its user registers stay in that CPU, so
+//	(unlike Run) there is nothing to save or restore.  If "cpu" is
+//	idle, dispatch the first ready thread to it.
+//
+//	Returns when some CPU switches back to ours.
+//----------------------------------------------------------------------
+
+void
+Scheduler::SwitchToCPU(int cpu)
+{
+    Thread *oldThread = kernel->currentThread;
+    Thread *nextThread = running[cpu];
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    if (nextThread == NULL) {
+	nextThread = FindNextToRun();
+	ASSERT(nextThread != NULL);
+	nextThread->setStatus(RUNNING);
+	Dispatch(nextThread);
+	running[cpu] = nextThread;
+	DEBUG(dbgThread, "Dispatching " << nextThread->getName() << " on idle CPU " << cpu);
+    }
+    oldThread->CheckOverflow();
+
+    kernel->machine->SwitchCPU(cpu);
+    kernel->currentThread = nextThread;
+    SWITCH(oldThread, nextThread);
+
+    // our CPU is being simulated again
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    CheckToBeDestroyed();
+}
+
 //----------------------------------------------------------------------
 // Scheduler::CheckToBeDestroyed
 // 	If the old thread gave up the processor because it was finishing,
@@ -174,6 +424,18 @@ Scheduler::CheckToBeDestroyed()
 void
 Scheduler::Print()
 {
+    if (numCPUs > 1) {
+	for (int cpu = 0; cpu < numCPUs; cpu++) {
+	    cout << "CPU " << cpu << ": ";
+	    if (running[cpu] != NULL)
+		running[cpu]->Print();
+	    else
+		cout << "idle";
+	    cout << "\n";
+	}
+    }
     cout << "Ready list contents:\n";
-    readyList->Apply(ThreadPrint);
+    if (nextUp != NULL)
+	ThreadPrint(nextUp);
+    policy->Apply(ThreadPrint);
 }
@@ -12,33 +12,78 @@
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
+#include "schedpolicy.h"
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
 // thread is running, and which threads are ready but not running.
+//
+// With more than one simulated CPU, there is a running thread (or
+// none) on each CPU; "kernel->currentThread" is the one on the CPU
+// being simulated at the moment.
+//
+// Which ready thread runs next is up to the scheduling policy (see
+// schedpolicy.h); the scheduler tells it how much CPU time each
+// thread has had, and when a thread that has just become ready
+// should pre-empt the one running.
+//
+// With handoff scheduling, a thread woken up by Semaphore::V (and so
+// by Lock::Release and Condition::Signal) runs next, whatever the
+// policy: it goes in a slot ahead of the ready list, and gets the CPU
+// as soon as the thread that woke it blocks or yields.  A thread that
+// wakes another and then waits for its answer (a request and its
+// response) then hands the CPU straight over, rather than the answer
+// waiting behind every other ready thread.
 
 class Scheduler {
   public:
-    Scheduler();		// Initialize list of ready threads 
+    Scheduler(int numCPUs, SchedPolicyType policyType, bool handOff);
+    				// Initialize list of ready threads 
     ~Scheduler();		// De-allocate ready list
 
     void ReadyToRun(Thread* thread);	
     				// Thread can be dispatched.
+    void WakeUp(Thread* thread);// Thread has been woken by a V
+    void SetHandOff(bool on) { handOff = on; }
+    bool IsHandingOff() { return handOff; }
+    				// Turn handoff scheduling on or off,
+				// or check whether it is on
+    void Blocking(Thread* thread, bool finishing);
+    				// Thread is about to block, or finish
     Thread* FindNextToRun();	// Dequeue first thread on the ready 
 				// list, if any, and return thread.
     void Run(Thread* nextThread, bool finishing);
     				// Cause nextThread to start running
+    bool IdleCPU(bool finishing);
+    				// Leave the current CPU idle, if
+				// another CPU has a thread to run
+
+    int NextCPU();		// The CPU to simulate after this one
+    void SwitchToCPU(int cpu);	// Switch to the thread on "cpu", giving
+				// it a ready thread if it is idle
     void CheckToBeDestroyed();// Check if thread that had been
     				// running needs to be deleted
     void Print();		// Print contents of ready list
+    bool NoneReady() { return policy->IsEmpty() && (nextUp == NULL); }
+    				// Is the ready list empty?
     
     // SelfTest for scheduler is implemented in class Thread
     
   private:
-    List<Thread *> *readyList;  // queue of threads that are ready to run,
-				// but not running
+    SchedPolicy *policy;	// the threads that are ready to run,
+				// but not running, and how to pick one
+    bool handOff;		// run woken threads next?
+    Thread *nextUp;		// with handoff, the thread to run next
+				// (ahead of the policy's), or NULL
     Thread *toBeDestroyed;	// finishing thread to be destroyed
     				// by the next thread that runs
+    int numCPUs;		// # of simulated CPUs
+    Thread *running[MaxCPUs];	// the thread on each CPU, NULL if idle
+
+    void Charge(Thread *thread);// Charge "thread" for the CPU time it
+    				// has had since it was last charged
+    void Dispatch(Thread *thread);
+    				// "thread" is being given a CPU
 };
 
 #endif // SCHEDULER_H
@@ -0,0 +1,222 @@
+// stackpool.cc
+//	Routines to manage pools of thread stacks (see stackpool.h).
+
+#include "debug.h"
+#include "stackpool.h"
+#include "sysdep.h"
+#include "main.h"
+
+// The stack pools of this host thread, one for each size.
+static __thread StackPool *allStackPools = NULL;
+
+// Are the pools in use?  (See UseStackPools.)
+static __thread bool stackPools = TRUE;
+
+//----------------------------------------------------------------------
+// StackPool::StackPool
+// 	Initialize an empty pool of stacks of "stackSize" words.
+//----------------------------------------------------------------------
+
+StackPool::StackPool(int stackSize)
+{
+    ASSERT(stackSize > 0);
+    size = stackSize;
+    pagesPerStack = divRoundUp(size * sizeof(int), HostPageSize());
+    freeList = NULL;
+    numAllocs = numHits = numSlabs = 0;
+    numInUse = maxInUse = 0;
+
+    nextPool = allStackPools;
+    allStackPools = this;
+}
+
+//----------------------------------------------------------------------
+// StackPool::Allocate
+// 	Return a stack: from the free list if we can, or else from a new
+//	slab (whose other stacks go on the free list).  A slab is laid
+//	out as a guard page, then each stack followed by a guard page.
+//----------------------------------------------------------------------
+
+int *
+StackPool::Allocate()
+{
+    int *stack;
+
+    numAllocs++;
+    if (freeList != NULL) {
+	numHits++;
+    } else {
+	int pageSize = HostPageSize();
+	int stride = (pagesPerStack + 1) * pageSize;
+	char *slab = AllocPages(StacksPerSlab * (pagesPerStack + 1) + 1);
+
+	numSlabs++;
+	GuardPage(slab);
+	for (int i = StacksPerSlab - 1; i >= 0; i--) {
+	    char *start = slab + pageSize + i * stride;
+
+	    GuardPage(start + pagesPerStack * pageSize);
+	    stack = (int *) start;
+	    *(int **) stack = freeList;
+	    freeList = stack;
+	}
+    }
+    stack = freeList;
+    freeList = *(int **) stack;
+    if (++numInUse > maxInUse)
+	maxInUse = numInUse;
+    return stack;
+}
+
+//----------------------------------------------------------------------
+// StackPool::Free
+// 	Put "stack", which came from Allocate, back on the free list.
+//----------------------------------------------------------------------
+
+void
+StackPool::Free(int *stack)
+{
+    ASSERT(numInUse > 0);
+    *(int **) stack = freeList;
+    freeList = stack;
+    numInUse--;
+}
+
+//----------------------------------------------------------------------
+// StackPool::Print
+// 	Print how the pool has been used.
+//----------------------------------------------------------------------
+
+void
+StackPool::Print()
+{
+    char line[120];
+
+    sprintf(line, "stacks %7d bytes: %9d allocations, %6.2f%% hits, "
+		"%4d slabs, %6d in use (%d at most)\n",
+		size * (int) sizeof(int), numAllocs,
+		(numAllocs > 0) ? (100.0 * numHits) / numAllocs : 0.0,
+		numSlabs, numInUse, maxInUse);
+    cout << line;
+}
+
+//----------------------------------------------------------------------
+// AllocStack
+// 	Return a stack of "size" words, from the pool of stacks of that
+//	size, first making the pool if need be.
+//----------------------------------------------------------------------
+
+int *
+AllocStack(int size)
+{
+    StackPool *pool;
+
+    if (!stackPools)
+	return (int *) AllocBoundedArray(size * sizeof(int));
+    for (pool = allStackPools; pool != NULL; pool = pool->nextPool) {
+	if (pool->Size() == size)
+	    break;
+    }
+    if (pool == NULL)
+	pool = new StackPool(size);
+    return pool->Allocate();
+}
+
+//----------------------------------------------------------------------
+// FreeStack
+// 	Put back "stack", of "size" words, in the pool it came from.
+//	If there is no pool of that size, the stack was allocated while
+//	the pools were off, so give it back the same way.
+//----------------------------------------------------------------------
+
+void
+FreeStack(int *stack, int size)
+{
+    StackPool *pool = NULL;
+
+    if (stackPools) {
+	for (pool = allStackPools; (pool != NULL) && (pool->Size() != size);
+						pool = pool->nextPool)
+	    ;
+    }
+    if (pool == NULL)
+	DeallocBoundedArray((char *) stack, size * sizeof(int));
+    else
+	pool->Free(stack);
+}
+
+//----------------------------------------------------------------------
+// UseStackPools
+// 	Turn the stack pools on or off.
+//----------------------------------------------------------------------
+
+void
+UseStackPools(bool on)
+{
+    stackPools = on;
+}
+
+//----------------------------------------------------------------------
+// PrintStackPools
+// 	Print the statistics of every stack pool of this host thread.
+//----------------------------------------------------------------------
+
+void
+PrintStackPools()
+{
+    cout << "Stack pools:\n";
+    for (StackPool *pool = allStackPools; pool != NULL; pool = pool->nextPool)
+	pool->Print();
+}
+
+//----------------------------------------------------------------------
+// ThreadBenchmark
+// 	Time forking and destroying BenchThreads threads, BenchBatch at
+//	a time, first with stacks from AllocBoundedArray and then with
+//	stacks from the pools.  The current thread yields until each
+//	batch has run and finished.
+//----------------------------------------------------------------------
+
+static const int BenchThreads = 100000;
+static const int BenchBatch = 100;
+
+static int numFinished;		// # of benchmark threads that have run
+
+static void
+BenchThread(int which)
+{
+    numFinished++;
+}
+
+void
+ThreadBenchmark()
+{
+    double seconds[2];
+
+    for (int pooled = 0; pooled <= 1; pooled++) {
+	double start = CPUSeconds();
+
+	UseStackPools(pooled);
+	numFinished = 0;
+	for (int i = 0; i < BenchThreads; i += BenchBatch) {
+	    for (int j = 0; j < BenchBatch; j++) {
+		Thread *t = new Thread("bench");
+		t->Fork((VoidFunctionPtr) BenchThread, (void *) (i + j),
+			SmallStackSize);
+	    }
+	    while (numFinished < i + BenchBatch)
+		kernel->currentThread->Yield();
+	}
+	seconds[pooled] = CPUSeconds() - start;
+    }
+    UseStackPools(TRUE);
+
+    for (int pooled = 0; pooled <= 1; pooled++) {
+	char line[100];
+
+	sprintf(line, "%d threads, %s: %.3f s, %.2f us per thread\n",
+		BenchThreads, pooled ? "stack pools" : "AllocBoundedArray",
+		seconds[pooled], 1e6 * seconds[pooled] / BenchThreads);
+	cout << line;
+    }
+}
@@ -0,0 +1,76 @@
+// stackpool.h
+//	Data structures for recycling the execution stacks of threads.
+//
+//	Every thread that is forked needs a stack, and a thread is
+//	often short-lived, so rather than allocate each stack (with
+//	AllocBoundedArray) and give it back when the thread is deleted,
+//	stacks are kept in pools, one for each size of stack.  A freed
+//	stack goes on its pool's free list, and the next thread forked
+//	takes it from there.
+//
+//	Stacks are carved out of slabs of StacksPerSlab stacks, mapped
+//	in one go from the host, with an inaccessible guard page between
+//	each stack and the next (and at both ends), so a stack overflow
+//	causes an error rather than quietly clobbering its neighbour.
+//	Slabs are only allocated when a pool runs out of stacks, and the
+//	host only gives real memory to the pages of a stack that are
+//	actually used, so a pool costs little until it is needed.
+//
+//	As with object pools (see pool.h), each host thread has its own
+//	stack pools, and their memory is never given back.  Statistics
+//	are printed when Nachos halts with the "p" debugging flag on.
+
+#ifndef STACKPOOL_H
+#define STACKPOOL_H
+
+#include "utility.h"
+
+// The number of stacks to carve out of each slab.
+const int StacksPerSlab = 16;
+
+// The following class defines a pool of stacks of one size.
+
+class StackPool {
+  public:
+    StackPool(int stackSize);	// Initialize an empty pool of stacks
+				// of "stackSize" words
+
+    int *Allocate();		// Return a stack
+    void Free(int *stack);	// Put a stack back in the pool
+
+    void Print();		// Print the pool's statistics
+    int Size() { return size; }	// How big the stacks are, in words
+
+    StackPool *nextPool;	// the other stack pools of this host thread
+
+  private:
+    int size;			// words per stack
+    int pagesPerStack;		// host pages per stack (rounded up)
+    int *freeList;		// stacks ready to hand out, linked
+				// through their first word
+
+    int numAllocs;		// # of stacks handed out
+    int numHits;		// ... of which came from the free list
+    int numSlabs;		// # of slabs carved up
+    int numInUse;		// # of stacks handed out, not yet freed
+    int maxInUse;		// the most there have ever been
+};
+
+// Return a stack of "size" words, from the pool for that size.
+extern int *AllocStack(int size);
+
+// Put back "stack", of "size" words, which came from AllocStack.
+extern void FreeStack(int *stack, int size);
+
+// Turn the pools on or off.  When they are off, each stack is
+// allocated with AllocBoundedArray, as before.  Only for when no thread
+// has a stack (for timing the two against each other).
+extern void UseStackPools(bool on);
+
+// Print the statistics of every stack pool of this host thread.
+extern void PrintStackPools();
+
+// Time creating and destroying many threads, with and without pools.
+extern void ThreadBenchmark();
+
+#endif // STACKPOOL_H
@@ -34,6 +34,7 @@
 
 #include "copyright.h"
 #include "synch.h"
+#include "sysdep.h"
 #include "main.h"
 
 //----------------------------------------------------------------------
@@ -48,7 +49,7 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
-    queue = new List<Thread *>;
+    queue = new ThreadQueue;
 }
 
 //----------------------------------------------------------------------
@@ -95,8 +96,11 @@ Semaphore::P()
 // Semaphore::V
 // 	Increment semaphore value, waking up a waiter if necessary.
 //	As with P(), this operation must be atomic, so we need to disable
-//	interrupts.  Scheduler::ReadyToRun() assumes that interrupts
+//	interrupts.  Scheduler::WakeUp() assumes that interrupts
 //	are disabled when it is called.
+//
+//	With handoff scheduling, the thread woken up runs next (see
+//	scheduler.h).
 //----------------------------------------------------------------------
 
 void
@@ -108,7 +112,7 @@ Semaphore::V()
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	
     
     if (!queue->IsEmpty()) {  // make thread ready.
-	kernel->scheduler->ReadyToRun(queue->RemoveFront());
+	kernel->scheduler->WakeUp(queue->RemoveFront());
     }
     value++;
     
@@ -149,6 +153,93 @@ Semaphore::SelfTest()
     delete ping;
 }
 
+//----------------------------------------------------------------------
+// PingPongBenchmark, PongThread, LoadThread
+// 	Time PingPongRounds round trips between two threads ping-ponging
+//	with a pair of semaphores, as in SelfTest, while PingPongLoad
+//	other threads are ready to run (each yielding in a loop), first
+//	without handoff scheduling and then with it.  Without handoff,
+//	each thread woken up waits behind the load threads.
+//
+//	For each, print the simulated time, the context switches and the
+//	host CPU time per round trip.
+//----------------------------------------------------------------------
+
+static const int PingPongRounds = 10000;
+static const int PingPongLoad = 4;
+
+static Semaphore *benchPing, *benchPong;
+static bool benchDone;			// tells the load threads to stop
+static int numBenchThreads;		// # of them still running
+
+static void
+PongThread(int rounds)
+{
+    for (int i = 0; i < rounds; i++) {
+	benchPing->P();
+	benchPong->V();
+    }
+    numBenchThreads--;
+}
+
+static void
+LoadThread(int which)
+{
+    while (!benchDone)
+	kernel->currentThread->Yield();
+    numBenchThreads--;
+}
+
+void
+PingPongBenchmark()
+{
+    Statistics *stats = kernel->stats;
+    bool wasHandingOff = kernel->scheduler->IsHandingOff();
+
+    for (int handOff = 0; handOff <= 1; handOff++) {
+	int startTicks, startSwitches;
+	double start, seconds;
+	char line[120];
+
+	kernel->scheduler->SetHandOff(handOff);
+	benchPing = new Semaphore("bench ping", 0);
+	benchPong = new Semaphore("bench pong", 0);
+	benchDone = FALSE;
+	numBenchThreads = PingPongLoad + 1;
+	for (int i = 0; i < PingPongLoad; i++) {
+	    Thread *t = new Thread("load");
+	    t->Fork((VoidFunctionPtr) LoadThread, (void *) i, SmallStackSize);
+	}
+	Thread *t = new Thread("pong");
+	t->Fork((VoidFunctionPtr) PongThread, (void *) PingPongRounds,
+		SmallStackSize);
+
+	startTicks = stats->totalTicks;
+	startSwitches = stats->numContextSwitches;
+	start = CPUSeconds();
+	for (int i = 0; i < PingPongRounds; i++) {
+	    benchPing->V();
+	    benchPong->P();
+	}
+	seconds = CPUSeconds() - start;
+	sprintf(line, "%s: %.1f ticks, %.2f context switches, "
+			"%.2f us per round trip\n",
+		handOff ? "handoff" : "ready list",
+		(double) (stats->totalTicks - startTicks) / PingPongRounds,
+		(double) (stats->numContextSwitches - startSwitches)
+							/ PingPongRounds,
+		1e6 * seconds / PingPongRounds);
+	cout << line;
+
+	benchDone = TRUE;
+	while (numBenchThreads > 0)
+	    kernel->currentThread->Yield();
+	delete benchPing;
+	delete benchPong;
+    }
+    kernel->scheduler->SetHandOff(wasHandingOff);
+}
+
 //----------------------------------------------------------------------
 // Lock::Lock
 // 	Initialize a lock, so that it can be used for synchronization.
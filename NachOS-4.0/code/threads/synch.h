@@ -50,7 +50,7 @@ class Semaphore {
   private:
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
-    List<Thread *> *queue;     
+    ThreadQueue *queue;
 		  	// threads waiting in P() for the value to be > 0
    };
 
@@ -145,3 +145,7 @@ class Condition {
 
 /* Elevator Test */
 void ElevatorTest(void);
+
+// Time ping-ponging between two threads, with and without handoff
+// scheduling (see scheduler.h).
+extern void PingPongBenchmark();
@@ -21,6 +21,7 @@
 #include "switch.h"
 #include "synch.h"
 #include "sysdep.h"
+#include "stackpool.h"
 
 // this is put at the top of the execution stack, for detecting stack overflows
 const int STACK_FENCEPOST = 0xdedbeef;
@@ -38,6 +39,7 @@ Thread::Thread(char* threadName)
     name = threadName;
     stackTop = NULL;
     stack = NULL;
+    stackSize = 0;
     status = JUST_CREATED;
     for (int i = 0; i < MachineStateSize; i++) {
 	machineState[i] = NULL;		// not strictly necessary, since
@@ -45,6 +47,18 @@ Thread::Thread(char* threadName)
 					// of machine registers
     }
     space = NULL;
+    priority = DefaultPriority;
+    userTicks = systemTicks = readyTicks = 0;
+    numSwitches = 0;
+    dispatchTick = 0;
+    readyTick = 0;
+    yielded = FALSE;
+    quantum = 0;
+    wakeTick = 0;
+    schedLevel = 0;
+    schedUsed = 0;
+    schedGeneration = 0;
+    schedPass = 0;
 }
 
 //----------------------------------------------------------------------
@@ -65,7 +79,7 @@ Thread::~Thread()
 
     ASSERT(this != kernel->currentThread);
     if (stack != NULL)
-	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+	FreeStack(stack, stackSize);
 }
 
 //----------------------------------------------------------------------
@@ -86,10 +100,13 @@ Thread::~Thread()
 // 	
 //	"func" is the procedure to run concurrently.
 //	"arg" is a single argument to be passed to the procedure.
+//	"stackWords" is the size of the thread's stack, in words: by
+//	default StackSize, but a thread that is known not to need so
+//	much (a service thread, say) can ask for less.
 //----------------------------------------------------------------------
 
 void 
-Thread::Fork(VoidFunctionPtr func, void *arg)
+Thread::Fork(VoidFunctionPtr func, void *arg, int stackWords)
 {
     Interrupt *interrupt = kernel->interrupt;
     Scheduler *scheduler = kernel->scheduler;
@@ -97,6 +114,8 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
     
     DEBUG(dbgThread, "Forking thread: " << name << " f(a): " << (int) func << " " << arg);
     
+    ASSERT(stackWords >= MinStackSize);
+    stackSize = stackWords;
     StackAllocate(func, arg);
 
     oldLevel = interrupt->SetLevel(IntOff);
@@ -105,6 +124,36 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
     (void) interrupt->SetLevel(oldLevel);
 }    
 
+//----------------------------------------------------------------------
+// Thread::setPriority
+// 	Change the thread's scheduling priority.  If the thread is
+//	already on the ready list, the new priority applies from the
+//	next time it is made ready.
+//
+//	"p" is the new priority, 0 .. NumPriorities - 1
+//----------------------------------------------------------------------
+
+void
+Thread::setPriority(int p)
+{
+    ASSERT((p >= 0) && (p < NumPriorities));
+    DEBUG(dbgThread, "Priority of " << name << " set to " << p);
+    priority = p;
+}
+
+//----------------------------------------------------------------------
+// Thread::PrintAccounting
+// 	Print how the thread has spent its time so far.
+//----------------------------------------------------------------------
+
+void
+Thread::PrintAccounting()
+{
+    cout << "Thread " << name << ": user " << userTicks << ", system "
+	<< systemTicks << ", ready " << readyTicks << " ticks, "
+	<< numSwitches << " switches\n";
+}
+
 //----------------------------------------------------------------------
 // Thread::CheckOverflow
 // 	Check a thread's stack to see if it has overrun the space
@@ -125,7 +174,7 @@ Thread::CheckOverflow()
 {
     if (stack != NULL) {
 #ifdef HPUX			// Stacks grow upward on the Snakes
-	ASSERT(stack[StackSize - 1] == STACK_FENCEPOST);
+	ASSERT(stack[stackSize - 1] == STACK_FENCEPOST);
 #else
 	ASSERT(*stack == STACK_FENCEPOST);
 #endif
@@ -175,6 +224,8 @@ Thread::Finish ()
     ASSERT(this == kernel->currentThread);
     
     DEBUG(dbgThread, "Finishing thread: " << name);
+    if (debug->IsEnabled(dbgThread))
+	PrintAccounting();
     
     Sleep(TRUE);				// invokes SWITCH
     // not reached
@@ -183,10 +234,15 @@ Thread::Finish ()
 //----------------------------------------------------------------------
 // Thread::Yield
 // 	Relinquish the CPU if any other thread is ready to run.
-//	If so, put the thread on the end of the ready list, so that
+//	If so, put the thread back on the ready list, so that
 //	it will eventually be re-scheduled.
 //
-//	NOTE: returns immediately if no other thread on the ready queue.
+//	The scheduling policy decides whether another thread should
+//	run instead, so the thread goes on the ready list first: with
+//	round robin, it goes behind every other ready thread; with
+//	priorities, it may well come straight back off.
+//
+//	NOTE: returns immediately if no other thread should run.
 //	Otherwise returns when the thread eventually works its way
 //	to the front of the ready list and gets re-scheduled.
 //
@@ -208,10 +264,12 @@ Thread::Yield ()
     
     DEBUG(dbgThread, "Yielding thread: " << name);
     
+    kernel->scheduler->ReadyToRun(this);
     nextThread = kernel->scheduler->FindNextToRun();
-    if (nextThread != NULL) {
-	kernel->scheduler->ReadyToRun(this);
+    if (nextThread != this) {
 	kernel->scheduler->Run(nextThread, FALSE);
+    } else {
+	status = RUNNING;		// no one else to run; carry on
     }
     (void) kernel->interrupt->SetLevel(oldLevel);
 }
@@ -228,7 +286,8 @@ Thread::Yield ()
 //	we have no thread to run.  "Interrupt::Idle" is called
 //	to signify that we should idle the CPU until the next I/O interrupt
 //	occurs (the only thing that could cause a thread to become
-//	ready to run).
+//	ready to run) -- unless another simulated CPU is still running
+//	a thread, in which case just this CPU goes idle.
 //
 //	NOTE: we assume interrupts are already disabled, because it
 //	is called from the synchronization routines which must
@@ -246,9 +305,14 @@ Thread::Sleep (bool finishing)
     
     DEBUG(dbgThread, "Sleeping thread: " << name);
 
+    kernel->scheduler->Blocking(this, finishing);
     status = BLOCKED;
-    while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL)
+    while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL) {
+	if (kernel->scheduler->IdleCPU(finishing))
+	    return;			// another CPU had work to do, and
+					// we have since been woken up
 	kernel->interrupt->Idle();	// no one to run, wait for an interrupt
+    }
     
     // returns when it's time for us to run
     kernel->scheduler->Run(nextThread, finishing); 
@@ -305,34 +369,34 @@ PLabelToAddr(void *plabel)
 void
 Thread::StackAllocate (VoidFunctionPtr func, void *arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    stack = AllocStack(stackSize);	// recycled, if we can (see stackpool.h)
 
 #ifdef PARISC
     // HP stack works from low addresses to high addresses
     // everyone else works the other way: from high addresses to low addresses
     stackTop = stack + 16;	// HP requires 64-byte frame marker
-    stack[StackSize - 1] = STACK_FENCEPOST;
+    stack[stackSize - 1] = STACK_FENCEPOST;
 #endif
 
 #ifdef SPARC
-    stackTop = stack + StackSize - 96; 	// SPARC stack must contains at 
+    stackTop = stack + stackSize - 96; 	// SPARC stack must contains at 
 					// least 1 activation record 
 					// to start with.
     *stack = STACK_FENCEPOST;
 #endif 
 
 #ifdef PowerPC // RS6000
-    stackTop = stack + StackSize - 16; 	// RS6000 requires 64-byte frame marker
+    stackTop = stack + stackSize - 16; 	// RS6000 requires 64-byte frame marker
     *stack = STACK_FENCEPOST;
 #endif 
 
 #ifdef DECMIPS
-    stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
+    stackTop = stack + stackSize - 4;	// -4 to be on the safe side!
     *stack = STACK_FENCEPOST;
 #endif
 
 #ifdef ALPHA
-    stackTop = stack + StackSize - 8;	// -8 to be on the safe side!
+    stackTop = stack + stackSize - 8;	// -8 to be on the safe side!
     *stack = STACK_FENCEPOST;
 #endif
 
@@ -341,7 +405,7 @@ Thread::StackAllocate (VoidFunctionPtr func, void *arg)
     // the x86 passes the return address on the stack.  In order for SWITCH() 
     // to go to ThreadRoot when we switch to this thread, the return addres 
     // used in SWITCH() must be the starting address of ThreadRoot.
-    stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
+    stackTop = stack + stackSize - 4;	// -4 to be on the safe side!
     *(--stackTop) = (int) ThreadRoot;
     *stack = STACK_FENCEPOST;
 #endif
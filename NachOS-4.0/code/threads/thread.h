@@ -24,7 +24,8 @@
 //	that your thread stacks are too small.)
 //	
 //	One thing to try if you find yourself with seg faults is to
-//	increase the size of thread stack -- ThreadStackSize.
+//	increase the size of thread stack -- StackSize, or the size
+//	passed to Thread::Fork.
 //
 //  	In this interface, forking a thread takes two steps.
 //	We must first allocate a data structure for it: "t = new Thread".
@@ -40,6 +41,7 @@
 #include "copyright.h"
 #include "utility.h"
 #include "sysdep.h"
+#include "list.h"
 
 #include "machine.h"
 #include "addrspace.h"
@@ -54,14 +56,25 @@
 #define MachineStateSize 75 
 
 
-// Size of the thread's private execution stack.
-// WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
+// Size of the thread's private execution stack, unless Fork is told
+// otherwise.  WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 const int StackSize = (8 * 1024);	// in words
 
+// Smaller stack sizes, for threads known not to need much.
+const int SmallStackSize = (2 * 1024);	// kernel service threads that
+					// don't call deeply
+const int MinStackSize = 256;		// the least Fork accepts
+
 
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 
+// Thread priorities, for the scheduling policies that use them (see
+// schedpolicy.h): higher numbers run first, or more often.
+const int NumPriorities = 8;
+const int DefaultPriority = 4;
+const int TicketsPerPriority = 100;	// lottery tickets per priority level
+
 
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
@@ -90,8 +103,9 @@ class Thread {
 
     // basic thread operations
 
-    void Fork(VoidFunctionPtr func, void *arg); 
-    				// Make thread run (*func)(arg)
+    void Fork(VoidFunctionPtr func, void *arg, int stackWords = StackSize);
+    				// Make thread run (*func)(arg), on a
+				// stack of "stackWords" words
     void Yield();  		// Relinquish the CPU if any 
 				// other thread is runnable
     void Sleep(bool finishing); // Put the thread to sleep and 
@@ -101,6 +115,11 @@ class Thread {
     
     void CheckOverflow();   	// Check if thread stack has overflowed
     void setStatus(ThreadStatus st) { status = st; }
+    ThreadStatus getStatus() { return status; }
+    int getPriority() { return priority; }
+    void setPriority(int p);	// takes effect when the thread is
+				// next made ready
+    int getTickets() { return TicketsPerPriority * (priority + 1); }
     char* getName() { return (name); }
     void Print() { cout << name; }
     void SelfTest();		// test whether thread impl is working
@@ -111,8 +130,10 @@ class Thread {
     int *stack; 	 	// Bottom of the stack 
 				// NULL if this is the main thread
 				// (If NULL, don't deallocate stack)
+    int stackSize;		// words in the stack
     ThreadStatus status;	// ready, running or blocked
     char* name;
+    int priority;		// 0 .. NumPriorities - 1
 
     void StackAllocate(VoidFunctionPtr func, void *arg);
     				// Allocate a stack for thread.
@@ -131,8 +152,42 @@ class Thread {
 
 
     AddrSpace *space;			// User code this thread is running.
+
+    ListLink<Thread> queueLink;		// for the ready list, or the wait
+					// queue of a semaphore; a thread is
+					// on at most one of them at a time
+
+// CPU accounting, in ticks.
+
+    int userTicks;			// time spent running user code
+    int systemTicks;			// time spent running in the kernel
+    int readyTicks;			// time spent ready but not running
+    int numSwitches;			// # of times given a CPU
+    void PrintAccounting();		// print the above
+
+// Bookkeeping for the scheduler and its policy (see schedpolicy.h).
+
+    int dispatchTick;			// when the thread was last given
+					// a CPU, or last charged for it
+    int readyTick;			// when it was last made ready
+    bool yielded;			// was it made ready by giving up
+					// the CPU, rather than waking up?
+    int quantum;			// its own time slice, with adaptive
+					// time slices (see alarm.h); 0 if
+					// it hasn't got one yet
+    int wakeTick;			// when to wake up, if in
+					// Alarm::WaitUntil
+    int schedLevel;			// feedback queue level
+    int schedUsed;			// ticks used on that level
+    int schedGeneration;		// boosts the thread has seen
+    long long schedPass;		// stride scheduling pass (64 bits,
+					// so that it never wraps)
 };
 
+// A queue of threads, linked through the threads themselves, so that
+// queueing a thread allocates nothing.
+typedef IntrusiveList<Thread, &Thread::queueLink> ThreadQueue;
+
 // external function, dummy routine whose sole job is to call Thread::Print
 extern void ThreadPrint(Thread *thread);	 
 
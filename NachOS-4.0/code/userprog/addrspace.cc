@@ -20,6 +20,7 @@
 #include "addrspace.h"
 #include "machine.h"
 #include "noff.h"
+#include "errno.h"
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -57,19 +58,41 @@ SwapHeader (NoffHeader *noffH)
 #endif
 }
 
-// read / write from kernel to user
+//----------------------------------------------------------------------
+// AddrSpace::userReadWrite
+// 	Copy "size" bytes between the kernel buffer "kspace" and the
+//	user's memory at "virtAddr" -- into the user's memory if "wflag"
+//	is set.  Pages that aren't in memory are brought in, and the
+//	use and dirty bits are set, and copy-on-write pages are copied,
+//	just as for the user program's own loads and stores.
+//
+//	Returns 0 if some of the bytes are outside the address space, or
+//	are to be written to a read-only page.
+//----------------------------------------------------------------------
+
 int 
 AddrSpace::userReadWrite(char *kspace, int virtAddr, int size, int wflag)
 {
     unsigned int vpn = (unsigned) virtAddr / PageSize;
-    int offset = virtAddr % PageSize;
+    int offset = (unsigned) virtAddr % PageSize;
     // handle cross pages
     int copySize = min(size, PageSize - offset);
     while (size)
     {
+        if (vpn >= numPages)
+            return 0;
+        if (!pageTable[vpn].valid)
+            PageIn(vpn);
+        if (wflag && pageTable[vpn].readOnly && !CopyOnWrite(vpn))
+            return 0;
+        pageTable[vpn].use = TRUE;
         int pa = pageTable[vpn].physicalPage * PageSize + offset;
         if (wflag)
+        {
             bcopy(kspace, kernel->machine->mainMemory + pa, copySize);
+            pageTable[vpn].dirty = TRUE;
+            kernel->machine->InvalidateCodePage(pageTable[vpn].physicalPage);
+        }
         else
             bcopy(kernel->machine->mainMemory + pa, kspace, copySize);
         size -= copySize;
@@ -81,34 +104,21 @@ AddrSpace::userReadWrite(char *kspace, int virtAddr, int size, int wflag)
     return 1;
 }
 
-// read <size> bytes from File <file> starting at <inFileAddr> to <virtAddr>
-// use kernel diskBuffer as an internel cache
-void
-AddrSpace::ReadFile(int virtAddr, OpenFile *file, int size, int inFileAddr)
-{
-    int readSize;
-    while (size)
-    {
-        readSize = min(PageSize, size);
-        file->ReadAt(kernel->diskBuffer, PageSize, inFileAddr);
-        userReadWrite(kernel->diskBuffer, virtAddr, readSize, 1);
-        inFileAddr += readSize;
-        virtAddr += readSize;
-        size -= readSize;
-    }
-}
-
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
-//	Set up the translation from program memory to physical 
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+//	The page table is set up by Load, Fork or ReadSnapshot.
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace()
 {
-    // pageTable is installed in Load or Fork
+    pageTable = NULL;
+    numPages = 0;
+    swapSlot = NULL;
+    copyOnWrite = NULL;
+    execName = NULL;
+    executable = NULL;
+    textId = -1;
     InitProc();
 }
 
@@ -119,132 +129,351 @@ AddrSpace::AddrSpace()
 
 AddrSpace::~AddrSpace()
 {
-    // free memory pages this process occupys
-    if (pageTable != NULL)
+    FreePages();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FreePages
+// 	Give back the frames of the pages in memory (or our share of
+//	them), the swap slots of the ones that have been swapped, the backing store reserved for
+//	them all, and the executable.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::FreePages()
+{
+    if (pageTable == NULL)
+        return;
+    for (int i = 0; i < numPages; i++)
     {
-        for (int i = 0; i < numPages; i++)
+        if (pageTable[i].valid)
         {
-            kernel->memmgr->clearPage(pageTable[i].physicalPage);
+            kernel->memmgr->clearPage(pageTable[i].physicalPage, this);
             DEBUG(dbgAddr, "Physical Page: " << pageTable[i].physicalPage
                     << " get freed!");
         }
-        delete pageTable;
+        if (swapSlot[i] != -1)
+            kernel->memmgr->swap->freeSlot(swapSlot[i]);
     }
+    kernel->memmgr->releasePages(numPages);
+    delete [] pageTable;
+    delete [] swapSlot;
+    delete [] copyOnWrite;
+    delete [] execName;
+    delete executable;
+    pageTable = NULL;
+    swapSlot = NULL;
+    copyOnWrite = NULL;
+    execName = NULL;
+    executable = NULL;
 }
 
+//----------------------------------------------------------------------
+// Overlaps
+// 	Does "segment" have any bytes in page "vpn"?
+//----------------------------------------------------------------------
+
+static bool
+Overlaps(Segment *segment, int vpn)
+{
+    return segment->size > 0
+        && segment->virtualAddr < (vpn + 1) * PageSize
+        && segment->virtualAddr + segment->size > vpn * PageSize;
+}
 
 //----------------------------------------------------------------------
 // AddrSpace::Load
-// 	Load a user program into memory from a file.
+// 	Load a user program into memory from a file -- or rather, set up
+//	the page table so that each page is read in from the file (or
+//	zeroed) when it is first touched.  Any program the address space
+//	was running before is thrown away, unless the file can't be
+//	opened or there isn't room in the swap area for the new one.
 //
-//	Assumes that the page table has been initialized, and that
-//	the object code file is in NOFF format.
+//	The pages that hold nothing but code and read-only data are
+//	marked read-only, so that they can be shared with the other
+//	processes running the program (see memmgr.h).
+//
+//	Assumes that the object code file is in NOFF format.
 //
 //	"fileName" is the file containing the object code to load into memory
+//
+//	Returns 0, or ENOENT or ENOMEM if the program can't be loaded.
 //----------------------------------------------------------------------
 
-bool 
+int 
 AddrSpace::Load(char *fileName) 
 {
-    // drop original pageTable and free corresponding memory (if any)
-    if (pageTable != NULL)
-    {
-        for (int i = 0; i < numPages; i++)
-        {
-            kernel->memmgr->clearPage(pageTable[i].physicalPage);
-            DEBUG(dbgAddr, "Physical Page: " << pageTable[i].physicalPage
-                    << " get freed!");
-        }
-        delete pageTable;
-    }
+    OpenFile *file = kernel->fileSystem->Open(fileName);
+    NoffHeader header;
+    unsigned int size, pages;
 
-    OpenFile *executable = kernel->fileSystem->Open(fileName);
-    NoffHeader noffH;
-    unsigned int size;
-
-    if (executable == NULL) {
+    if (file == NULL) {
         cerr << "Unable to open file " << fileName << "\n";
-        return FALSE;
+        return ENOENT;
     }
 
-    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) && 
-		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
-    	SwapHeader(&noffH);
-    ASSERT(noffH.noffMagic == NOFFMAGIC);
+    file->ReadAt((char *)&header, sizeof(header), 0);
+    if ((header.noffMagic != NOFFMAGIC) && 
+		(WordToHost(header.noffMagic) == NOFFMAGIC))
+    	SwapHeader(&header);
+    ASSERT(header.noffMagic == NOFFMAGIC);
 
 #ifdef RDATA
 // how big is address space?
-    size = noffH.code.size + noffH.readonlyData.size + noffH.initData.size +
-           noffH.uninitData.size + UserStackSize;	
+    size = header.code.size + header.readonlyData.size + header.initData.size +
+           header.uninitData.size + UserStackSize;	
                                                 // we need to increase the size
 						// to leave room for the stack
 #else
 // how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
+    size = header.code.size + header.initData.size + header.uninitData.size 
 			+ UserStackSize;	// we need to increase the size
 						// to leave room for the stack
 #endif
-    numPages = divRoundUp(size, PageSize);
-    size = numPages * PageSize;
+    pages = divRoundUp(size, PageSize);
+    if (!kernel->memmgr->reservePages(pages)) {
+        DEBUG(dbgAddr, "No room in the swap area for " << pages << " pages");
+        delete file;
+        return ENOMEM;
+    }
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
-						// to run anything too big --
-						// at least until we have
-						// virtual memory
+    // drop original pageTable and free corresponding memory (if any)
+    if (pageTable != NULL)
+    {
+        FreePages();
+        kernel->machine->FlushTranslations();   // may have been in use
+    }
+    executable = file;
+    execName = new char[strlen(fileName) + 1];
+    strcpy(execName, fileName);
+    textId = kernel->memmgr->textId(fileName);
+    noffH = header;
+    numPages = pages;
+    size = numPages * PageSize;
+#ifdef RDATA
+    int textEnd = max(noffH.code.virtualAddr + noffH.code.size,
+                noffH.readonlyData.virtualAddr + noffH.readonlyData.size);
+#else
+    int textEnd = noffH.code.virtualAddr + noffH.code.size;
+#endif
 
     DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
 
     pageTable = new TranslationEntry[numPages];
-    ASSERT(kernel->memmgr->reservePages(numPages));
+    swapSlot = new int[numPages];
+    copyOnWrite = new bool[numPages];
     for (int i = 0; i < numPages; i++) {
         pageTable[i].virtualPage = i;
-        int ppn = kernel->memmgr->getPage();
-        pageTable[i].physicalPage = ppn;
-        DEBUG(dbgAddr, "[Page Table]: vpn " << i << " ppn " << ppn );
-        pageTable[i].valid = TRUE;
+        pageTable[i].physicalPage = -1;
+        pageTable[i].valid = FALSE;     // not in memory yet
         pageTable[i].use = FALSE;
         pageTable[i].dirty = FALSE;
-        pageTable[i].readOnly = FALSE;
-        bzero(kernel->machine->mainMemory + ppn * PageSize, PageSize);
+        pageTable[i].readOnly = ((i + 1) * PageSize <= textEnd
+                && !Overlaps(&noffH.initData, i)
+                && !Overlaps(&noffH.uninitData, i));
+        swapSlot[i] = -1;
+        copyOnWrite[i] = FALSE;
     }
 
+    return 0;				// success
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReadPage
+// 	Read the contents of page "vpn", which isn't in memory, into
+//	"into": from its swap slot, if it has one, or else from the
+//	parts of the code and data segments that fall in the page (the
+//	rest of the page is zero).
+//----------------------------------------------------------------------
+
+static void
+ReadSegment(OpenFile *executable, Segment *segment, int vpn, char *into)
+{
+    int start = max(vpn * PageSize, segment->virtualAddr);
+    int end = min((vpn + 1) * PageSize,
+                        segment->virtualAddr + segment->size);
 
-// then, copy in the code and data segments into memory
-    if (noffH.code.size > 0) {
-        DEBUG(dbgAddr, "Initializing code segment.");
+    if (start < end)
+        executable->ReadAt(into + start - vpn * PageSize, end - start,
+                segment->inFileAddr + start - segment->virtualAddr);
+}
 
-	    DEBUG(dbgAddr, "VA: " << noffH.code.virtualAddr << ", "
-                << "Size: " << noffH.code.size);
- 
-        ReadFile(noffH.code.virtualAddr, executable, 
-                noffH.code.size, noffH.code.inFileAddr);
+void
+AddrSpace::ReadPage(int vpn, char *into)
+{
+    if (swapSlot[vpn] != -1) {
+        kernel->memmgr->swap->readSlot(swapSlot[vpn], into);
+        return;
     }
+    bzero(into, PageSize);
+    ASSERT(executable != NULL);
+    ReadSegment(executable, &noffH.code, vpn, into);
+#ifdef RDATA
+    ReadSegment(executable, &noffH.readonlyData, vpn, into);
+#endif
+    ReadSegment(executable, &noffH.initData, vpn, into);
+}
 
-    if (noffH.initData.size > 0) {
-        DEBUG(dbgAddr, "Initializing data segment.");
+//----------------------------------------------------------------------
+// AddrSpace::PageIn
+// 	Bring page "vpn" into memory, after a page fault: find it a
+//	frame (perhaps evicting another page), read it in, and make its
+//	page table entry valid.  The frame stays pinned while it is being
+//	read, in case reading the executable blocks.
+//
+//	A copy-on-write page that was evicted comes back in a frame of
+//	its own, so it is writable again.  A text page is looked for in
+//	the page cache first, and put there once it has been read in.
+//----------------------------------------------------------------------
 
-	    DEBUG(dbgAddr, "VA: " << noffH.initData.virtualAddr << ", "
-                << "Size: " << noffH.initData.size);
+void
+AddrSpace::PageIn(int vpn)
+{
+    ASSERT(vpn >= 0 && vpn < numPages && !pageTable[vpn].valid);
+
+    bool text = IsText(vpn);
+    int key = text ? kernel->memmgr->textKey(textId, vpn) : -1;
+    int ppn = text ? kernel->memmgr->findText(key, this) : -1;
+    bool shared = (ppn != -1);
+
+    kernel->stats->numPageFaults++;
+    proc->numFaults++;
+    if (shared) {
+        DEBUG(dbgAddr, "Page fault: vpn " << vpn << " shares ppn " << ppn);
+    } else {
+        ppn = kernel->memmgr->getPage(this, vpn);
+        DEBUG(dbgAddr, "Page fault: vpn " << vpn << " into ppn " << ppn
+                << (swapSlot[vpn] != -1 ? " from swap" : ""));
+        ReadPage(vpn, kernel->machine->mainMemory + ppn * PageSize);
+        kernel->machine->InvalidateCodePage(ppn);
+        if (text)
+            kernel->memmgr->cacheText(ppn, key);
+    }
 
-        ReadFile(noffH.initData.virtualAddr, executable,
-                noffH.initData.size, noffH.initData.inFileAddr);
+    pageTable[vpn].physicalPage = ppn;
+    pageTable[vpn].use = FALSE;
+    pageTable[vpn].dirty = FALSE;       // same as its backing store
+    pageTable[vpn].valid = TRUE;
+    if (copyOnWrite[vpn]) {
+        pageTable[vpn].readOnly = FALSE;
+        copyOnWrite[vpn] = FALSE;
     }
+    if (!shared)
+        kernel->memmgr->unpinPage(ppn);
+}
 
-#ifdef RDATA
-    if (noffH.readonlyData.size > 0) {
-        DEBUG(dbgAddr, "Initializing read only data segment.");
+//----------------------------------------------------------------------
+// AddrSpace::WorkingSet
+// 	Return how many of our pages are in our working set: in memory,
+//	and used since their use bits were last cleared (see
+//	ReplacePolicy::InWorkingSet).
+//----------------------------------------------------------------------
 
-	    DEBUG(dbgAddr, "VA: " << noffH.readonlyData.virtualAddr << ", "
-                "Size: " << noffH.readonlyData.size);
+int
+AddrSpace::WorkingSet()
+{
+    int num = 0;
 
-        ReadFile(noffH.readonlyData.virtualAddr, executable, 
-                noffH.readonlyData.size, noffH.readonlyData.inFileAddr);
+    for (int i = 0; i < numPages; i++) {
+        if (pageTable[i].valid && pageTable[i].use)
+            num++;
     }
-#endif
+    return num;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsText
+// 	Is page "vpn" one of the program's code and read-only data pages,
+//	which all the processes running it can share?  Those are the
+//	pages that are read-only, other than for copy-on-write, and that
+//	come straight from the executable.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsText(int vpn)
+{
+    return textId != -1 && pageTable[vpn].readOnly && !copyOnWrite[vpn]
+        && swapSlot[vpn] == -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageOut
+// 	Evict page "vpn" from memory, so that its frame can be reused.
+//	If it is dirty, write it to its swap slot first (giving it one if
+//	it hasn't got one yet, or shares it with another process); a
+//	clean page can be read in again from where it came from.  The
+//	machine may have cached the translation, so the cached ones are
+//	flushed.
+//
+//	The frame's other sharers, if any, are paged out too (see
+//	MemoryManager::getPage).
+//----------------------------------------------------------------------
+
+void
+AddrSpace::PageOut(int vpn)
+{
+    TranslationEntry *entry = &pageTable[vpn];
+    SwapArea *swap = kernel->memmgr->swap;
+
+    ASSERT(entry->valid);
+    kernel->stats->numPageEvictions++;
+    proc->numEvictions++;
+    if (entry->dirty) {
+        if (swapSlot[vpn] != -1 && swap->isShared(swapSlot[vpn])) {
+            swap->freeSlot(swapSlot[vpn]);
+            swapSlot[vpn] = -1;
+        }
+        if (swapSlot[vpn] == -1)
+            swapSlot[vpn] = swap->allocSlot();
+        DEBUG(dbgAddr, "Writing vpn " << vpn << " to swap slot "
+                << swapSlot[vpn]);
+        swap->writeSlot(swapSlot[vpn],
+                kernel->machine->mainMemory + entry->physicalPage * PageSize);
+        kernel->stats->numPageWritebacks++;
+        proc->numWritebacks++;
+        entry->dirty = FALSE;
+    }
+    entry->valid = FALSE;
+    kernel->machine->FlushTranslations();
+}
 
-    delete executable;			// close file
-    return TRUE;			// success
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Make page "vpn", which is in memory, writable, after a write to
+//	it raised a ReadOnlyException.  If it is shared copy-on-write
+//	with other processes, copy it into a frame of our own first; if
+//	the others have let go of it, it is ours already.  The faulting
+//	instruction is then run again.
+//
+//	Returns FALSE if the page really is read-only.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyOnWrite(int vpn)
+{
+    TranslationEntry *entry = &pageTable[vpn];
+    int old = entry->physicalPage;
+
+    ASSERT(entry->valid && entry->readOnly);
+    if (!copyOnWrite[vpn])
+        return FALSE;
+    if (kernel->memmgr->shareCount(old) > 1) {
+        kernel->memmgr->pinPage(old);
+        int ppn = kernel->memmgr->getPage(this, vpn);
+        DEBUG(dbgAddr, "Copy on write: vpn " << vpn << " from ppn " << old
+                << " to ppn " << ppn);
+        bcopy(kernel->machine->mainMemory + old * PageSize,
+                kernel->machine->mainMemory + ppn * PageSize, PageSize);
+        kernel->machine->InvalidateCodePage(ppn);
+        kernel->memmgr->unpinPage(old);
+        kernel->memmgr->clearPage(old, this);
+        entry->physicalPage = ppn;
+        kernel->memmgr->unpinPage(ppn);
+    }
+    entry->readOnly = FALSE;
+    copyOnWrite[vpn] = FALSE;
+    kernel->machine->FlushTranslations();
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -325,13 +554,15 @@ void AddrSpace::SaveState()
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table, and
+//	forget any translations it cached from the previous one.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
     kernel->machine->pageTable = pageTable;
     kernel->machine->pageTableSize = numPages;
+    kernel->machine->FlushTranslations();
 }
 
 
@@ -357,6 +588,10 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
 
     pte = &pageTable[vpn];
 
+    if(!pte->valid) {
+        return PageFaultException;
+    }
+
     if(isReadWrite && pte->readOnly) {
         return ReadOnlyException;
     }
@@ -397,40 +632,156 @@ AddrSpace::InitProc()
     proc->joinNum = 0;
     proc->alive = true;
     proc->retValue = 0;
+    proc->numFaults = proc->numEvictions = proc->numWritebacks = 0;
     // add proc to list
     kernel->procmgr->procs[proc->pid] = proc;
 }
 
-AddrSpace*                                                                      
-AddrSpace::Fork()                                                               
-{                                                                               
-    AddrSpace *dup = new AddrSpace();                                             
+//----------------------------------------------------------------------
+// AddrSpace::Fork
+// 	Make a copy of this address space, which is the current one, for
+//	a child process -- copy-on-write, so that forking costs a page
+//	table rather than the pages.  The pages in memory are shared by
+//	the two processes, read-only, until one of them writes to a page
+//	and gets its own copy (see CopyOnWrite); the swapped pages share
+//	their swap slots, until one of them is written back; and the rest
+//	will be read in from the executable, which the child opens for
+//	itself.  (A process restored from a snapshot has all those pages
+//	in the swap area.)
+//
+//	The child isn't made while memory is overcommitted, for a while
+//	(see MemoryManager::admitProcess).
+//
+//	Returns NULL if the executable can't be opened again, or there
+//	isn't room in the swap area for the child.
+//----------------------------------------------------------------------
+
+AddrSpace*
+AddrSpace::Fork()
+{
+    OpenFile *file = NULL;
+
     ASSERT(proc == kernel->currentThread->space->proc);
-    dup->proc->ppid = proc->pid;                                                
-    dup->numPages = numPages;                                                   
+    kernel->memmgr->admitProcess();
+    if (!kernel->memmgr->reservePages(numPages)) {
+        DEBUG(dbgAddr, "No room in the swap area for a child");
+        return NULL;
+    }
+    if (execName != NULL) {
+        file = kernel->fileSystem->Open(execName);
+        if (file == NULL) {
+            kernel->memmgr->releasePages(numPages);
+            return NULL;
+        }
+    }
+
+    AddrSpace *dup = new AddrSpace();
+    dup->proc->ppid = proc->pid;
+    dup->numPages = numPages;
     dup->pageTable = new TranslationEntry[numPages];
-    // copy page table                                                          
-    ASSERT(kernel->memmgr->reservePages(numPages));
+    dup->swapSlot = new int[numPages];
+    dup->copyOnWrite = new bool[numPages];
+    if (execName != NULL) {
+        dup->execName = new char[strlen(execName) + 1];
+        strcpy(dup->execName, execName);
+    }
+    dup->executable = file;
+    dup->noffH = noffH;
+    dup->textId = textId;
 
     DEBUG(dbgAddr, "Forking address space: " << numPages << " pages.");
 
-    unsigned int src, dest;
-    for (int i = 0; i < numPages; i++)                                          
-    {                                                                           
-        dup->pageTable[i].virtualPage = i;               
-        int ppn = kernel->memmgr->getPage();
-        dup->pageTable[i].physicalPage = ppn;             
-        DEBUG(dbgAddr, "[Page Table]: vpn " << i << " ppn " << ppn);
-        dup->pageTable[i].valid = pageTable[i].valid;                           
-        dup->pageTable[i].use = pageTable[i].use;                               
-        dup->pageTable[i].dirty = pageTable[i].dirty;                           
-        dup->pageTable[i].readOnly = pageTable[i].readOnly;
-
-        src = pageTable[i].physicalPage * PageSize;
-        dest = dup->pageTable[i].physicalPage * PageSize;
-        bcopy(kernel->machine->mainMemory + src,
-                kernel->machine->mainMemory + dest, PageSize);
-    }                                                                           
-
-    return dup;                                                                 
+    for (int i = 0; i < numPages; i++)
+    {
+        if (pageTable[i].valid && !pageTable[i].readOnly)
+        {
+            pageTable[i].readOnly = TRUE;
+            copyOnWrite[i] = TRUE;
+        }
+        if (pageTable[i].valid)
+            kernel->memmgr->sharePage(pageTable[i].physicalPage, dup);
+        if (swapSlot[i] != -1)
+            kernel->memmgr->swap->shareSlot(swapSlot[i]);
+        dup->pageTable[i] = pageTable[i];   // dirty, if ours is
+        dup->pageTable[i].use = FALSE;
+        dup->swapSlot[i] = swapSlot[i];
+        dup->copyOnWrite[i] = copyOnWrite[i];
+    }
+    kernel->machine->FlushTranslations();   // ours are read-only now
+
+    return dup;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WriteSnapshot
+// 	Write the page table to the open file "fd", followed by the
+//	contents of each page that isn't in memory (the pages in memory
+//	are saved along with the rest of main memory; see
+//	Machine::WriteSnapshot).  So the snapshot doesn't depend on the
+//	swap area, or on the executable.  The restored process has no
+//	one to share its pages with, so copy-on-write pages are saved as
+//	writable.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::WriteSnapshot(int fd)
+{
+    WriteFile(fd, (char *) &numPages, sizeof(numPages));
+    for (int i = 0; i < numPages; i++) {
+        TranslationEntry entry = pageTable[i];
+
+        if (copyOnWrite[i])
+            entry.readOnly = FALSE;
+        WriteFile(fd, (char *) &entry, sizeof(TranslationEntry));
+    }
+    for (int i = 0; i < numPages; i++) {
+        if (!pageTable[i].valid) {
+            ReadPage(i, kernel->diskBuffer);
+            WriteFile(fd, kernel->diskBuffer, PageSize);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReadSnapshot
+// 	Rebuild the page table from a snapshot, taking back the same
+//	physical pages, so that the restored main memory lines up, and
+//	putting the pages that weren't in memory in the swap area.
+//	Called on a freshly made address space, on a machine that has
+//	no other processes.  Without the executable, the pages in memory
+//	have no other copy, so they are dirty.
+//
+//	Returns FALSE if there isn't room in the swap area for them.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::ReadSnapshot(int fd)
+{
+    SwapArea *swap = kernel->memmgr->swap;
+    unsigned int pages;
+
+    Read(fd, (char *) &pages, sizeof(pages));
+    if (!kernel->memmgr->reservePages(pages))
+        return FALSE;
+    numPages = pages;
+    pageTable = new TranslationEntry[numPages];
+    swapSlot = new int[numPages];
+    copyOnWrite = new bool[numPages];
+    Read(fd, (char *) pageTable, numPages * sizeof(TranslationEntry));
+
+    for (int i = 0; i < numPages; i++) {
+        swapSlot[i] = -1;
+        copyOnWrite[i] = FALSE;
+        if (pageTable[i].valid) {
+            kernel->memmgr->claimPage(pageTable[i].physicalPage, this, i);
+            pageTable[i].dirty = TRUE;
+            DEBUG(dbgAddr, "[Page Table]: vpn " << i << " ppn "
+                    << pageTable[i].physicalPage);
+        } else {
+            Read(fd, kernel->diskBuffer, PageSize);
+            swapSlot[i] = swap->allocSlot();
+            swap->writeSlot(swapSlot[i], kernel->diskBuffer);
+        }
+    }
+    return TRUE;
 }
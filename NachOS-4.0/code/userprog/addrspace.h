@@ -2,9 +2,16 @@
 //	Data structures to keep track of executing user programs 
 //	(address spaces).
 //
-//	For now, we don't keep any information about address spaces.
-//	The user level CPU state is saved and restored in the thread
-//	executing the user program (see thread.h).
+//	Pages are brought into memory on demand: nothing is loaded when
+//	a program starts, and a page is read in -- from the executable,
+//	or from the swap area if it has been evicted while dirty -- the
+//	first time it is touched (see memmgr.h).  A forked address space
+//	shares its parent's pages until one of them writes to a page
+//	(copy-on-write; see AddrSpace::Fork), and all the processes
+//	running a program share its code and read-only data (see
+//	memmgr.h).  The user level CPU
+//	state is saved and restored in the thread executing the user
+//	program (see thread.h).
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -15,6 +22,7 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "noff.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
 
@@ -27,6 +35,9 @@ struct Proc {
     bool alive;
     int joinNum;
     int retValue;
+    int numFaults;      // pages brought in,
+    int numEvictions;   // evicted,
+    int numWritebacks;  // and written to swap when evicted
 };
 
 class AddrSpace {
@@ -34,9 +45,10 @@ class AddrSpace {
     AddrSpace();			// Create an address space.
     ~AddrSpace();			// De-allocate an address space
 
-    bool Load(char *fileName);		// Load a program into addr space from
+    int Load(char *fileName);		// Load a program into addr space from
                                         // a file
-					// return false if not found
+					// return ENOENT if not found, or
+					// ENOMEM if there is no room
 
     void Execute();             	// Run a program
 					// assumes the program has already
@@ -47,15 +59,28 @@ class AddrSpace {
 
     AddrSpace* Fork();
 
+    // Save the page table to an open file, for a snapshot of the
+    // machine, or rebuild it from one (see snapshot.h).
+    void WriteSnapshot(int fd);
+    bool ReadSnapshot(int fd);
+
     // Translate virtual address _vaddr_
     // to physical address _paddr_. _mode_
     // is 0 for Read, 1 for Write.
     ExceptionType Translate(unsigned int vaddr, unsigned int *paddr, int mode);
 
-    void ReadFile(int virtAddr, OpenFile *file, int size, int inFileAddr);
-
+    // Copy "size" bytes between the kernel and the user's memory,
+    // bringing in pages as need be.  Return 0 if the address is bad.
     int userReadWrite(char *kspace, int virtAddr, int size, int wflag);
 
+    void PageIn(int vpn);		// Bring in page "vpn", on a page fault
+    void PageOut(int vpn);		// Evict page "vpn" from memory
+    bool CopyOnWrite(int vpn);		// Make page "vpn" writable, on a
+					// read-only fault; FALSE if it
+					// really is read-only
+    TranslationEntry *PageEntry(int vpn) { return &pageTable[vpn]; }
+    int WorkingSet();			// # of pages in the working set
+
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
 
@@ -65,8 +90,24 @@ class AddrSpace {
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+    int *swapSlot;			// where each page is in the swap
+					// area, or -1 if it isn't
+    bool *copyOnWrite;			// which pages are read-only only
+					// because they are shared
+    char *execName;			// the program, and its header:
+    OpenFile *executable;		// where the pages not in the swap
+    NoffHeader noffH;			// area come from (NULL, if from a
+					// snapshot)
+    int textId;				// the program, for the page cache
+					// (-1, if from a snapshot)
 
     void InitProc();
+    void FreePages();			// Give back the memory, swap slots
+					// and executable
+    void ReadPage(int vpn, char *into);	// Read in the contents of page
+					// "vpn", which isn't in memory
+    bool IsText(int vpn);		// Is page "vpn" shared code or
+					// read-only data?
 
 };
 
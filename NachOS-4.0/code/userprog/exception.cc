@@ -62,6 +62,18 @@ ExceptionHandler(ExceptionType which)
     	case SyscallException:
       		SystemCallHandler(type);
       	break;
+    case PageFaultException:
+	/* bring in the page, and run the faulting instruction again */
+	kernel->currentThread->space->PageIn(
+		(unsigned) kernel->machine->ReadRegister(BadVAddrReg) / PageSize);
+	return;
+    case ReadOnlyException:
+	/* copy a copy-on-write page, and run the faulting instruction again */
+	if (kernel->currentThread->space->CopyOnWrite(
+		(unsigned) kernel->machine->ReadRegister(BadVAddrReg) / PageSize))
+	    return;
+      	cerr << "Write to a read-only page\n";
+      	break;
     default:
       	cerr << "Unexpected user mode exception" << (int)which << "\n";
       	break;
@@ -23,9 +23,11 @@ static int ReadStr(int virtAddr, char *buf, unsigned size)
 
     DEBUG(dbgSys, "read string from VA: " << virtAddr << " to kernel buffer.");
 
+    AddrSpace *space = kernel->currentThread->space;
     char *sp = buf;
     do {
-        kernel->machine->ReadMem(virtAddr++, sizeof(char), (int *)sp);
+        if (!space->userReadWrite(sp, virtAddr++, sizeof(char), 0))
+            return -1;
     } while (*sp++ != '\0' && sp < buf + size);
     DEBUG(dbgSys, "read string: " << buf);
     return sp - buf;
@@ -42,14 +44,35 @@ static int WriteStr(int virtAddr, char *buf, unsigned size)
 
     DEBUG(dbgSys, "write string from kernel buffer to VA: " << virtAddr);
 
+    AddrSpace *space = kernel->currentThread->space;
     char *sp = buf;
     do {
-        kernel->machine->WriteMem(virtAddr++, sizeof(char), (int)*sp);
+        if (!space->userReadWrite(sp, virtAddr++, sizeof(char), 1))
+            return -1;
     } while (*sp++ != '\0' && sp < buf + size);
     DEBUG(dbgSys, "write string: " << buf);     // Unreliable debug info!
     return sp - buf;
 }
 
+// ReadWord, WriteWord
+// read or write a word of the current process's memory at virtAddr
+// (paging it in if need be).  return FALSE if the address is bad.
+static bool ReadWord(int virtAddr, int *value)
+{
+    if (!kernel->currentThread->space->userReadWrite((char *)value, virtAddr,
+                sizeof(int), 0))
+        return FALSE;
+    *value = WordToHost(*value);
+    return TRUE;
+}
+
+static bool WriteWord(int virtAddr, int value)
+{
+    value = WordToMachine(value);
+    return kernel->currentThread->space->userReadWrite((char *)&value,
+            virtAddr, sizeof(int), 1);
+}
+
 void SysHalt()
 {
   kernel->interrupt->Halt();
@@ -100,9 +123,10 @@ int SysExec(int uname)
     char *kname = new char[MAX_ARG_LEN];
     if (ReadStr(uname, kname, MAX_ARG_LEN) == -1)
         return 1;
-    if (kernel->currentThread->space->Load(kname) == FALSE)
-        return 1;
+    int err = kernel->currentThread->space->Load(kname);
     delete []kname;
+    if (err != 0)
+        return err;
     DEBUG(dbgSys, "[System Call] New Executable Loaded.");
     kernel->currentThread->space->Execute();
     ASSERTNOTREACHED();
@@ -114,7 +138,7 @@ int SysExecV(int argc, int argv)
     // get progname, and store it in kprogname
     int uprogname;
     char *kprogname = new char[MAX_ARG_LEN];
-    if (kernel->machine->ReadMem(argv, sizeof(char *), &uprogname) == FALSE)
+    if (ReadWord(argv, &uprogname) == FALSE)
         return 1;
     if (ReadStr(uprogname, kprogname, MAX_ARG_LEN) == -1)
         return 1;
@@ -126,22 +150,23 @@ int SysExecV(int argc, int argv)
     for (int i = 0; i < argc; i++)
     {
         kargv[i] = new char[MAX_ARG_LEN];
-        if (kernel->machine->ReadMem(argv + i * sizeof(char *), sizeof(char *),
-                    &uargv) == FALSE)
+        if (ReadWord(argv + i * sizeof(char *), &uargv) == FALSE)
             return 1;
         if (ReadStr(uargv, kargv[i], MAX_ARG_LEN) == -1)
             return 1;
         DEBUG(dbgSys, "[System Call] Arg " << i << ": " << kargv[i]);
     }
 
-    if (kernel->currentThread->space->Load(kprogname) == FALSE)
-        return 1;
+    int err = kernel->currentThread->space->Load(kprogname);
+    if (err != 0)
+        return err;
     DEBUG(dbgSys, "[System Call] Program " << kprogname << " Loaded.");
 
-    // set up stack
+    // set up stack, for the new program
     int stackBottom;
     int argHead;
 
+    kernel->currentThread->space->InitRegisters();
     stackBottom = kernel->machine->ReadRegister(StackReg)
         + 16 - UserStackSize + 16;
 
@@ -149,8 +174,7 @@ int SysExecV(int argc, int argv)
 
     for (int i = 0; i < argc; i++)
     {
-        if (kernel->machine->WriteMem(stackBottom + i * sizeof(char *),
-                sizeof(char *), argHead) == FALSE)
+        if (WriteWord(stackBottom + i * sizeof(char *), argHead) == FALSE)
             return 1;
         int len = WriteStr(argHead, kargv[i], MAX_ARG_LEN);
         if (len == -1)
@@ -164,7 +188,6 @@ int SysExecV(int argc, int argv)
 
     // since we need to pass arguments,
     // we do not use AddrSpace::Execute directly.
-    kernel->currentThread->space->InitRegisters();
     kernel->currentThread->space->RestoreState();
     // pass arguements
     kernel->machine->WriteRegister(4, argc);
@@ -1,10 +1,35 @@
 #include "memmgr.h"
+#include "addrspace.h"
 #include "synch.h"
+#include "main.h"
 
-MemoryManager::MemoryManager()
+static int
+FrameTextKey(Frame *frame)
 {
+    return frame->textKey;
+}
+
+static unsigned int
+HashTextKey(int key)
+{
+    return (unsigned int) key;
+}
+
+MemoryManager::MemoryManager(ReplacePolicyType policyType, int num)
+{
+    ASSERT(num > 0 && num <= NumPhysPages);
+    numFrames = num;
     lock = new Lock("MemoryManager Lock");
-    flags = new Bitmap(NumPhysPages);
+    flags = new Bitmap(numFrames);
+    swap = new SwapArea();
+    for (int i = 0; i < NumPhysPages; i++) {
+        frames[i].spaces = new List<AddrSpace *>;
+        frames[i].pinned = FALSE;
+        frames[i].textKey = -1;
+    }
+    policy = NewReplacePolicy(policyType, frames, numFrames);
+    textPages = new HashTable<int, Frame *>(FrameTextKey, HashTextKey);
+    textNames = new List<char *>;
     used = 0;
 }
 
@@ -12,45 +37,353 @@ MemoryManager::~MemoryManager()
 {
     delete lock;
     delete flags;
+    delete swap;
+    delete policy;
+    for (int i = 0; i < NumPhysPages; i++)
+        delete frames[i].spaces;
+    delete textPages;
+    while (!textNames->IsEmpty())
+        delete [] textNames->RemoveFront();
+    delete textNames;
 }
 
-// reservePages must be called before call getPage!
+// Return a frame for page "vpn" of "space", evicting some other page
+// if no frame is free.  The frame is pinned, so that it isn't taken
+// back while it is being filled; the caller unpins it.
 int
-MemoryManager::getPage()
+MemoryManager::getPage(AddrSpace *space, int vpn)
 {
     lock->Acquire();
     int result = flags->FindAndSet();
-    //TODO: what if result is -1, that is out of memory?
-    ASSERT(result != -1);
+    if (result == -1) {
+        result = policy->Victim();
+        Frame *victim = &frames[result];
+        DEBUG(dbgAddr, "Evicting vpn " << victim->virtualPage
+                << " of " << victim->spaces->NumInList()
+                << " process(es) from frame " << result);
+        while (!victim->spaces->IsEmpty())
+            victim->spaces->RemoveFront()->PageOut(victim->virtualPage);
+        uncacheText(result);
+    }
+    frames[result].spaces->Append(space);
+    frames[result].virtualPage = vpn;
+    frames[result].pinned = TRUE;
+    policy->Loaded(result);
     lock->Release();
     return result;
 }
 
 void
-MemoryManager::clearPage(int i)
+MemoryManager::clearPage(int i, AddrSpace *space)
 {
     lock->Acquire();
-    //TODO: what if clear a page which is out of range?
-    if(!flags->Test(i))
-        return;
-    flags->Clear(i);
-    used--;
+    ASSERT(i >= 0 && i < numFrames && flags->Test(i));
+    frames[i].spaces->Remove(space);
+    if (frames[i].spaces->IsEmpty() && frames[i].textKey == -1) {
+        flags->Clear(i);
+        frames[i].pinned = FALSE;
+    }
+    lock->Release();
+}
+
+void
+MemoryManager::sharePage(int i, AddrSpace *space)
+{
+    lock->Acquire();
+    ASSERT(i >= 0 && i < numFrames && flags->Test(i));
+    frames[i].spaces->Append(space);
+    lock->Release();
+}
+
+void
+MemoryManager::pinPage(int i)
+{
+    ASSERT(!frames[i].spaces->IsEmpty() && !frames[i].pinned);
+    frames[i].pinned = TRUE;
+}
+
+void
+MemoryManager::unpinPage(int i)
+{
+    ASSERT(frames[i].pinned);
+    frames[i].pinned = FALSE;
+}
+
+// used when restoring a snapshot, to get back the very pages that
+// the process had
+void
+MemoryManager::claimPage(int i, AddrSpace *space, int vpn)
+{
+    lock->Acquire();
+    ASSERT(i >= 0 && i < numFrames && !flags->Test(i));
+    flags->Mark(i);
+    frames[i].spaces->Append(space);
+    frames[i].virtualPage = vpn;
+    frames[i].pinned = FALSE;
+    policy->Loaded(i);
     lock->Release();
 }
 
+int
+MemoryManager::textId(char *fileName)
+{
+    int id = 0;
+
+    lock->Acquire();
+    ListIterator<char *> it(textNames);
+    for (; !it.IsDone() && strcmp(it.Item(), fileName) != 0; it.Next())
+        id++;
+    if (it.IsDone()) {
+        char *name = new char[strlen(fileName) + 1];
+        strcpy(name, fileName);
+        textNames->Append(name);
+    }
+    lock->Release();
+    return id;
+}
+
+int
+MemoryManager::findText(int key, AddrSpace *space)
+{
+    Frame *frame;
+    int result = -1;
+
+    lock->Acquire();
+    if (textPages->Find(key, &frame)) {
+        result = frame - frames;
+        frame->spaces->Append(space);
+    }
+    lock->Release();
+    return result;
+}
+
+// If another process has cached the same page in the meantime, this
+// copy stays private.
+void
+MemoryManager::cacheText(int i, int key)
+{
+    lock->Acquire();
+    if (!textPages->IsInTable(key)) {
+        frames[i].textKey = key;
+        textPages->Insert(&frames[i]);
+    }
+    lock->Release();
+}
+
+// called when frame "i" is taken for another page
+void
+MemoryManager::uncacheText(int i)
+{
+    if (frames[i].textKey != -1) {
+        textPages->Remove(frames[i].textKey);
+        frames[i].textKey = -1;
+    }
+}
+
 int
 MemoryManager::getFreePageCount()
 {
-    return NumPhysPages - used;
+    return flags->NumClear();
 }
 
+// reserve backing store for "num" pages, all or nothing
 bool
 MemoryManager::reservePages(int num)
 {
     lock->Acquire();
-    bool ok = (NumPhysPages - used >= num);
+    bool ok = (NumSwapPages - used >= num);
     if (ok)
         used += num;
     lock->Release();
     return ok;
 }
+
+void
+MemoryManager::releasePages(int num)
+{
+    lock->Acquire();
+    ASSERT(used >= num);
+    used -= num;
+    lock->Release();
+}
+
+// Each shared page counts once, however many processes use it.
+int
+MemoryManager::workingSetPages()
+{
+    int num = 0;
+
+    lock->Acquire();
+    for (int i = 0; i < numFrames; i++) {
+        if (flags->Test(i) && policy->InWorkingSet(i))
+            num++;
+    }
+    lock->Release();
+    return num;
+}
+
+// Defer the creation of a process while memory is overcommitted, so
+// that a burst of Forks doesn't make everyone thrash.  A process that
+// is the only one has nothing to wait for; and as the processes that
+// could free memory might be waiting for this one, it waits only so
+// long.
+void
+MemoryManager::admitProcess()
+{
+    for (int n = 0; n < MaxAdmitWaits; n++) {
+        int inUse = workingSetPages();
+
+        if (inUse + NewWorkingSet <= numFrames
+                || kernel->procmgr->numAlive() <= 1)
+            return;
+        if (n == 0)
+            kernel->stats->numDeferredForks++;
+        DEBUG(dbgAddr, "Deferring fork of process "
+                << kernel->currentThread->space->proc->pid
+                << " (working set " << kernel->currentThread->space->WorkingSet()
+                << "): " << inUse << " of " << numFrames
+                << " frames in working sets");
+        kernel->alarm->WaitUntil(AdmitWaitTicks);
+    }
+}
+
+// Clearing a use bit flushes the translations the machine has cached:
+// a cached translation is used without setting the bit again.
+bool
+Frame::WasUsed(bool clear)
+{
+    bool used = FALSE;
+
+    for (ListIterator<AddrSpace *> it(spaces); !it.IsDone(); it.Next()) {
+        TranslationEntry *entry = it.Item()->PageEntry(virtualPage);
+        used = used || entry->use;
+        if (clear)
+            entry->use = FALSE;
+    }
+    if (clear && used)
+        kernel->machine->FlushTranslations();
+    return used;
+}
+
+bool
+Frame::IsDirty()
+{
+    for (ListIterator<AddrSpace *> it(spaces); !it.IsDone(); it.Next()) {
+        if (it.Item()->PageEntry(virtualPage)->dirty)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+ReplacePolicy *
+NewReplacePolicy(ReplacePolicyType type, Frame *frames, int numFrames)
+{
+    switch (type) {
+      case FifoReplace:
+        return new FifoReplacePolicy(frames, numFrames);
+      case ClockReplace:
+        return new ClockReplacePolicy(frames, numFrames);
+      case EnhancedClockReplace:
+        return new EnhancedClockReplacePolicy(frames, numFrames);
+      case LruReplace:
+        return new LruReplacePolicy(frames, numFrames);
+    }
+    ASSERTNOTREACHED();
+    return NULL;
+}
+
+int
+ReplacePolicy::Advance()
+{
+    int i = hand;
+
+    hand = (hand + 1) % numFrames;
+    return i;
+}
+
+FifoReplacePolicy::FifoReplacePolicy(Frame *f, int n) : ReplacePolicy(f, n)
+{
+    loadedAt = new int[numFrames];
+    numLoads = 0;
+}
+
+// Clear the use bits as we go, for InWorkingSet.
+int
+FifoReplacePolicy::Victim()
+{
+    int victim = -1;
+
+    for (int i = 0; i < numFrames; i++) {
+        frames[i].WasUsed(TRUE);
+        if (!frames[i].pinned
+                && (victim == -1 || loadedAt[i] < loadedAt[victim]))
+            victim = i;
+    }
+    ASSERT(victim != -1);       // every frame is pinned
+    return victim;
+}
+
+// Two sweeps are enough: the first clears every use bit that it
+// doesn't stop at.
+int
+ClockReplacePolicy::Victim()
+{
+    for (int n = 0; n < 2 * numFrames + 1; n++) {
+        Frame *frame = &frames[Advance()];
+
+        if (!frame->pinned && !frame->WasUsed(TRUE))
+            return frame - frames;
+    }
+    ASSERTNOTREACHED();         // every frame is pinned
+    return -1;
+}
+
+// Each round is a sweep for an unused clean page, leaving the use bits
+// alone, and then one for any unused page, clearing them.  After the
+// first round no use bits are set, so the second finds a victim.
+int
+EnhancedClockReplacePolicy::Victim()
+{
+    for (int round = 0; round < 2; round++) {
+        for (int n = 0; n < numFrames; n++) {
+            Frame *frame = &frames[Advance()];
+
+            if (!frame->pinned && !frame->WasUsed(FALSE) && !frame->IsDirty())
+                return frame - frames;
+        }
+        for (int n = 0; n < numFrames; n++) {
+            Frame *frame = &frames[Advance()];
+
+            if (!frame->pinned && !frame->WasUsed(TRUE))
+                return frame - frames;
+        }
+    }
+    ASSERTNOTREACHED();         // every frame is pinned
+    return -1;
+}
+
+LruReplacePolicy::LruReplacePolicy(Frame *f, int n) : ReplacePolicy(f, n)
+{
+    age = new unsigned int[numFrames];
+    for (int i = 0; i < numFrames; i++)
+        age[i] = 0;
+}
+
+// Ties go to the first frame after the last victim, so that equally
+// old pages take turns.
+int
+LruReplacePolicy::Victim()
+{
+    int victim = -1;
+
+    for (int n = 0; n < numFrames; n++) {
+        int i = Advance();
+
+        age[i] = (age[i] >> 1) | (frames[i].WasUsed(TRUE) ? LruNewAge : 0);
+        if (!frames[i].pinned && (victim == -1 || age[i] < age[victim]))
+            victim = i;
+    }
+    ASSERT(victim != -1);       // every frame is pinned
+    hand = (victim + 1) % numFrames;
+    return victim;
+}
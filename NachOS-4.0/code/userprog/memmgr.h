@@ -2,22 +2,207 @@
 #define __USERPORG_MEMMGR_H__
 #include "bitmap.h"
 #include "machine.h"
+#include "stats.h"
+#include "list.h"
+#include "hash.h"
+#include "swap.h"
 
 class Lock;
+class AddrSpace;
+
+// What is in a frame of physical memory.
+struct Frame {
+    List<AddrSpace *> *spaces;  // whose page it is (empty if the frame
+                        // is free); more than one after a Fork
+    int virtualPage;    // which page of each of them
+    bool pinned;        // being filled or copied, so not to be evicted
+    int textKey;        // the text page it holds (see textKey), or -1
+
+    bool WasUsed(bool clear);   // has any of them used the page since
+                        // its use bit was last cleared?  Clear it if
+                        // "clear" is set
+    bool IsDirty();     // has any of them written it?
+};
+
+// The kinds of page replacement policy (picked with -rp).
+enum ReplacePolicyType { FifoReplace, ClockReplace, EnhancedClockReplace,
+                         LruReplace };
+
+// A page replacement policy chooses which page to evict when there is
+// no free frame.  The policies look at the use and dirty bits that
+// Machine::Translate sets in the page tables:
+//
+//   FifoReplace -- the page that has been in memory longest.  It
+//      ignores the use bits, but clears them each time it chooses,
+//      so that the working sets can still be measured.
+//   ClockReplace -- second chance: the frames are swept in turn, and
+//      the first whose page hasn't been used since the last sweep is
+//      evicted; the use bits of the others are cleared as we go.
+//   EnhancedClockReplace -- the clock, but preferring a clean page to
+//      a dirty one (which must be written to the swap area): first
+//      look for a page that is neither used nor dirty, then for one
+//      that isn't used (clearing use bits), and so on.
+//   LruReplace -- an approximation of least recently used, by aging:
+//      whenever a victim is needed, each frame's age is shifted right,
+//      with its use bit (which is then cleared) shifted in at the top,
+//      and the page with the smallest age is evicted.
+//
+// A policy clears use bits only while choosing a victim.  Clearing one
+// flushes the translations that the machine has cached (see
+// Frame::WasUsed), so the bit is set again the next time the page is
+// used -- whether or not the victim has any sharers to page it out,
+// which a cached text page has not.  Pinned frames are never chosen.
+//
+// Each policy also says which frames are in the working sets: by
+// default, those whose page has been used since the policy last
+// cleared its use bit.
+
+class ReplacePolicy {
+  public:
+    ReplacePolicy(Frame *f, int n) { frames = f; numFrames = n; hand = 0; }
+    virtual ~ReplacePolicy() {}
+
+    virtual void Loaded(int i) {}       // frame "i" has a new page
+    virtual int Victim() = 0;           // the frame to evict
+    virtual bool InWorkingSet(int i)    // is frame "i"'s page in use?
+        { return frames[i].WasUsed(FALSE); }
+
+  protected:
+    Frame *frames;
+    int numFrames;
+    int hand;           // where the next sweep starts
+
+    int Advance();      // the frame at the hand, moving it on
+};
+
+// Make a new replacement policy of the given kind, for "numFrames"
+// frames.
+extern ReplacePolicy *NewReplacePolicy(ReplacePolicyType type,
+                                       Frame *frames, int numFrames);
+
+class FifoReplacePolicy : public ReplacePolicy {
+  public:
+    FifoReplacePolicy(Frame *f, int n);
+    ~FifoReplacePolicy() { delete [] loadedAt; }
+    void Loaded(int i) { loadedAt[i] = numLoads++; }
+    int Victim();
+  private:
+    int *loadedAt;      // when each frame's page was brought in
+    int numLoads;
+};
+
+class ClockReplacePolicy : public ReplacePolicy {
+  public:
+    ClockReplacePolicy(Frame *f, int n) : ReplacePolicy(f, n) {}
+    int Victim();
+};
+
+class EnhancedClockReplacePolicy : public ReplacePolicy {
+  public:
+    EnhancedClockReplacePolicy(Frame *f, int n) : ReplacePolicy(f, n) {}
+    int Victim();
+};
+
+const unsigned int LruNewAge = 0x80000000;     // the age of a page
+                        // just brought in: as if just used
+
+class LruReplacePolicy : public ReplacePolicy {
+  public:
+    LruReplacePolicy(Frame *f, int n);
+    ~LruReplacePolicy() { delete [] age; }
+    void Loaded(int i) { age[i] = LruNewAge; }
+    int Victim();
+    bool InWorkingSet(int i)    // used since the last aging, or before it
+        { return frames[i].WasUsed(FALSE) || (age[i] & LruNewAge); }
+  private:
+    unsigned int *age;  // each frame's use in the last 32 sweeps,
+                        // most recent in the top bit
+};
+
+// Pages of user programs are brought into memory when they are first
+// touched (see AddrSpace::PageIn).  When there is no free frame, one
+// is taken from another page, chosen by the replacement policy.  A
+// dirty page goes to the swap area first.
+//
+// Pages of code and read-only data (text pages) are never written, so
+// all the processes running a program can share one copy of each.
+// The frames holding them are kept in a page cache, keyed by the
+// program and the page: a process finds a text page there before
+// reading it from the executable (see AddrSpace::PageIn).  A text page
+// stays cached when the last process using it lets go of it, so that
+// the next run of the program finds it; as no one is using it, it is
+// among the first to be evicted.  Programs are known by file name, so
+// one that is changed while Nachos is running isn't noticed.
+//
+// Admission control: while the working sets of the processes (the
+// pages in memory that the replacement policy counts as recently used;
+// see ReplacePolicy::InWorkingSet) fill memory, a new process would only
+// make them all thrash, so a Fork waits a while for processes to
+// exit, or for their working sets to shrink, before going ahead (see
+// admitProcess).  A process that can't reserve backing store isn't
+// created at all: Fork and Exec fail with ENOMEM.
+//
+// With -frames, only the first few frames of main memory are used for
+// user pages, to see how programs (and policies) do with less memory.
+//
+// A forked process shares its parent's frames, copy-on-write: the
+// page is read-only for all its sharers until one of them writes to
+// it and gets a copy of its own (AddrSpace::CopyOnWrite).  The frame
+// is freed when the last sharer lets go of it; evicting it evicts the
+// page from all of them.
+//
+// Rather than frames, a process reserves backing store: a swap slot
+// for each of its pages, so that eviction never runs out of room.
+
+const int NewWorkingSet = 8;    // the pages a new process is expected
+                                // to need straight away
+const int AdmitWaitTicks = 10 * TimerTicks;     // how long a deferred
+                                // Fork waits before looking again,
+const int MaxAdmitWaits = 20;   // and how many times, before it goes
+                                // ahead anyway
 
 class MemoryManager
 {
     public:
-        MemoryManager();
+        MemoryManager(ReplacePolicyType policyType, int numFrames);
         ~MemoryManager();
-        int getPage();
-        void clearPage(int i);
+        int getPage(AddrSpace *space, int vpn);
+                        // a frame for page "vpn" of "space", pinned
+        void clearPage(int i, AddrSpace *space);
+                        // "space" no longer has the page in frame "i"
+        void sharePage(int i, AddrSpace *space);
+                        // "space" has it too (the same page number)
+        int shareCount(int i) { return frames[i].spaces->NumInList(); }
+        void pinPage(int i);
+        void unpinPage(int i);
         int getFreePageCount();
-        bool reservePages(int num);
+        int frameCount() { return numFrames; } // the frames in use (-frames)
+        bool reservePages(int num);     // FALSE if there isn't room
+        void releasePages(int num);
+        int workingSetPages();  // the frames in the working sets
+        void admitProcess();    // wait until a new process fits
+        void claimPage(int i, AddrSpace *space, int vpn);
+                        // getPage, for a particular frame
+        int textId(char *fileName);     // a number for the program
+        int textKey(int id, int vpn) { return id * NumSwapPages + vpn; }
+                        // the key of text page "vpn" of program "id"
+        int findText(int key, AddrSpace *space);
+                        // the frame caching text page "key", now
+                        // shared by "space", or -1 if it isn't cached
+        void cacheText(int i, int key);
+                        // frame "i" holds text page "key"
+        SwapArea *swap;
     private:
         Bitmap *flags;
-        int used;       // the number of used pages
+        Frame frames[NumPhysPages];
+        int numFrames;  // how many of them are used
+        ReplacePolicy *policy;
+        HashTable<int, Frame *> *textPages;     // the page cache
+        List<char *> *textNames;        // the programs, by textId
+        int used;       // the number of reserved pages
         Lock *lock;
+
+        void uncacheText(int i);
 };
 
 #endif
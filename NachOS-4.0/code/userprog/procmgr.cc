@@ -1,10 +1,17 @@
 #include "procmgr.h"
 #include "synch.h"
+#include "main.h"
 
 ProcessManager::ProcessManager()
 {
     flags = new Bitmap(MaxNumProcesses);
     lock = new Lock("procmgr");
+    for (int i=0; i<MaxNumProcesses; i++)
+    {
+        procs[i] = NULL;
+        locks[i] = NULL;
+        conds[i] = NULL;
+    }
 }
 
 ProcessManager::~ProcessManager()
@@ -73,3 +80,27 @@ ProcessManager::getCondition(int pid)
         conds[pid] = new Condition("proc condition");
     return conds[pid];
 }
+
+int
+ProcessManager::numAlive()
+{
+    int num = 0;
+    for (int i = 0; i < MaxNumProcesses; i++)
+    {
+        if (procs[i] != NULL && procs[i]->alive)
+            num++;
+    }
+    return num;
+}
+
+void
+ProcessManager::printPaging()
+{
+    for (int i = 0; i < MaxNumProcesses; i++)
+    {
+        if (procs[i] != NULL)
+            cout << "Process " << i << ": page faults " << procs[i]->numFaults
+                 << ", evictions " << procs[i]->numEvictions
+                 << ", writebacks " << procs[i]->numWritebacks << "\n";
+    }
+}
@@ -19,6 +19,8 @@ class ProcessManager
         Condition* getCondition(int pid);
         Proc *procs[MaxNumProcesses];
         bool validPID(int pid);
+        int numAlive();         // the processes that haven't exited
+        void printPaging();     // each process's paging statistics
     private:
         Bitmap *flags;
         Lock *lock;
@@ -0,0 +1,176 @@
+// snapshot.cc
+//	Routines to save a running machine to a file, and to pick up
+//	where it left off in a later run (see snapshot.h).
+//
+//	A snapshot file is laid out as:
+//
+//		header (magic number, the size of the machine, and
+//			the frames used for user pages)
+//		statistics
+//		main memory, then the registers (Machine::WriteSnapshot)
+//		pending interrupts (Interrupt::WriteSnapshot)
+//		page table, and the pages not in memory
+//			(AddrSpace::WriteSnapshot)
+
+#include "main.h"
+#include "snapshot.h"
+#include "addrspace.h"
+#include "procmgr.h"
+#include "memmgr.h"
+
+// The header of a snapshot: a snapshot can only be restored on a
+// machine of the same size, using the same frames for user pages
+// (see -frames), since the process gets back the very frames it had.
+
+static const int SnapshotMagic = 0x534e4150;	// "SNAP"
+static const int HeaderSize = 6;
+static const int FramesField = 5;		// where the -frames limit is
+
+static void
+MakeHeader(int *header)
+{
+    header[0] = SnapshotMagic;
+    header[1] = MemorySize;
+    header[2] = NumPhysPages;
+    header[3] = PageSize;
+    header[4] = NumTotalRegs;
+    header[FramesField] = kernel->memmgr->frameCount();
+}
+
+//----------------------------------------------------------------------
+// Snapshot::Snapshot
+// 	Arrange to save the machine at tick "when".  Called once the
+//	kernel is initialized.
+//
+//	"fileName" is the UNIX file to write the snapshot to
+//	"when" is the time (in ticks since the machine booted) to take it
+//----------------------------------------------------------------------
+
+Snapshot::Snapshot(char *name, int when)
+{
+    int now = kernel->stats->totalTicks;
+
+    fileName = name;
+    kernel->interrupt->Schedule(this, (when > now) ? when - now : 1,
+    							SnapshotInt);
+}
+
+//----------------------------------------------------------------------
+// Snapshot::CallBack
+// 	Called when it is time to take the snapshot.  If the machine
+//	is busy, try again on the next tick.  The machine keeps running
+//	afterwards either way.
+//----------------------------------------------------------------------
+
+void
+Snapshot::CallBack()
+{
+    if (kernel->machine->NumCPUs() > 1) {
+	cerr << "Snapshots need a single CPU; not taken\n";
+	return;
+    }
+    if (Ready()) {
+	Write();
+    } else if (kernel->interrupt->NextDueTick() < 0) {
+	// nothing else will ever happen; don't keep Idle from halting
+	cerr << "Machine never became quiet; snapshot not taken\n";
+    } else {
+	DEBUG(dbgInt, "Putting off snapshot");
+	kernel->interrupt->Schedule(this, 1, SnapshotInt);
+    }
+}
+
+//----------------------------------------------------------------------
+// Snapshot::Ready
+// 	Return TRUE if everything about the machine that matters is in
+//	the snapshot: we are between user instructions, the current
+//	process is the only one (no other threads ready, or blocked
+//	inside the kernel), and no device is in the middle of anything.
+//----------------------------------------------------------------------
+
+bool
+Snapshot::Ready()
+{
+    AddrSpace *space = kernel->currentThread->space;
+
+    if ((kernel->interrupt->getStatus() != UserMode) || (space == NULL))
+	return FALSE;
+    if (!kernel->scheduler->NoneReady() || !kernel->interrupt->DevicesIdle())
+	return FALSE;
+    for (int i = 0; i < MaxNumProcesses; i++) {
+	Proc *proc = kernel->procmgr->procs[i];
+	if ((proc != NULL) && proc->alive && (proc != space->proc))
+	    return FALSE;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Snapshot::Write
+// 	Write the state of the machine to the snapshot file.
+//----------------------------------------------------------------------
+
+void
+Snapshot::Write()
+{
+    int header[HeaderSize];
+    int fd = OpenForWrite(fileName);
+
+    MakeHeader(header);
+    WriteFile(fd, (char *) header, sizeof(header));
+    WriteFile(fd, (char *) kernel->stats, sizeof(Statistics));
+    kernel->machine->WriteSnapshot(fd);
+    kernel->interrupt->WriteSnapshot(fd);
+    kernel->currentThread->space->WriteSnapshot(fd);
+    Close(fd);
+    cout << "Snapshot written to " << fileName << " at tick "
+    				<< kernel->stats->totalTicks << "\n";
+}
+
+//----------------------------------------------------------------------
+// RestoreSnapshot
+// 	Load a snapshot into the machine, which has just booted, and
+//	run the process in it from where it was saved.  The current
+//	thread becomes that process.
+//
+//	"fileName" is the UNIX file holding the snapshot
+//----------------------------------------------------------------------
+
+void
+RestoreSnapshot(char *fileName)
+{
+    int header[HeaderSize], expected[HeaderSize];
+    int fd = OpenForReadWrite(fileName, TRUE);
+    AddrSpace *space;
+
+    MakeHeader(expected);
+    Read(fd, (char *) header, sizeof(header));
+    if (bcmp(header, expected, FramesField * sizeof(int)) != 0) {
+	cerr << fileName << " is not a snapshot of a machine like this one\n";
+	Exit(1);
+    }
+    if (header[FramesField] != expected[FramesField]) {
+	cerr << fileName << " was taken using " << header[FramesField]
+	     << " frames for user pages, not " << expected[FramesField]
+	     << " (see -frames)\n";
+	Exit(1);
+    }
+    Read(fd, (char *) kernel->stats, sizeof(Statistics));
+    kernel->machine->ReadSnapshot(fd);
+    if (!kernel->interrupt->ReadSnapshot(fd)) {
+	cerr << "The devices of " << fileName << " don't match this machine's\n";
+	Exit(1);
+    }
+    space = new AddrSpace;
+    if (!space->ReadSnapshot(fd)) {
+	cerr << "The process in " << fileName << " doesn't fit in the swap area\n";
+	Exit(1);
+    }
+    Close(fd);
+    DEBUG(dbgAddr, "Restored snapshot at tick " << kernel->stats->totalTicks);
+
+    kernel->currentThread->space = space;
+    space->RestoreState();		// load page table register
+    kernel->machine->Run();		// pick up where the snapshot left off
+    ASSERTNOTREACHED();
+}
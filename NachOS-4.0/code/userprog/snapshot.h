@@ -0,0 +1,48 @@
+// snapshot.h
+//	Data structures for saving the state of a running machine to a
+//	file, and for starting a new Nachos from that file rather than
+//	booting and loading a program from scratch ("warm starts").
+//
+//	A snapshot holds main memory, the CPU registers, the page table
+//	of the running process (and those of its pages that are not in
+//	memory), when each pending interrupt is due,
+//	and the statistics.  To keep that enough, a snapshot is only
+//	taken at a quiet moment: between two user instructions, with
+//	one CPU, one process (no other threads ready or waiting), and
+//	no disk, console or network operation in progress.  Until then,
+//	the snapshot is put off a tick at a time.
+//
+//	NOT saved: the file system (the UNIX files, or the Nachos disk),
+//	the random number generator used by -rs, and what has already
+//	been written to the console.  The file is in the byte order and
+//	layout of the host that wrote it.
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "utility.h"
+#include "callback.h"
+
+// The following class takes a snapshot of the machine, when it
+// comes to the time requested.
+
+class Snapshot : public CallBackObj {
+  public:
+    Snapshot(char *fileName, int when);
+    				// Save the machine to "fileName" at
+				// (or soon after) tick "when"
+
+  private:
+    char *fileName;		// where to write the snapshot
+
+    void CallBack();		// called when it is time
+    bool Ready();		// is the machine quiet enough?
+    void Write();		// write the snapshot
+};
+
+// Replace the program the machine would have run with the one saved
+// in a snapshot, and continue running it.  Never returns.
+
+extern void RestoreSnapshot(char *fileName);
+
+#endif // SNAPSHOT_H
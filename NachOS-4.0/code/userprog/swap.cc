@@ -0,0 +1,62 @@
+#include "swap.h"
+#include "machine.h"
+#include "sysdep.h"
+#include "main.h"
+
+SwapArea::SwapArea()
+{
+    sprintf(name, "SWAP_%d", kernel->hostName);
+    fd = OpenForWrite(name);
+    slots = new Bitmap(NumSwapPages);
+    refs = new int[NumSwapPages];
+}
+
+SwapArea::~SwapArea()
+{
+    Close(fd);
+    Unlink(name);
+    delete slots;
+    delete [] refs;
+}
+
+// MemoryManager::reservePages makes sure that there is a slot for every
+// page that might need one, so we never run out.
+int
+SwapArea::allocSlot()
+{
+    int slot = slots->FindAndSet();
+    ASSERT(slot != -1);
+    refs[slot] = 1;
+    return slot;
+}
+
+void
+SwapArea::shareSlot(int slot)
+{
+    ASSERT(slots->Test(slot));
+    refs[slot]++;
+}
+
+void
+SwapArea::freeSlot(int slot)
+{
+    ASSERT(slots->Test(slot) && refs[slot] > 0);
+    if (--refs[slot] == 0)
+        slots->Clear(slot);
+}
+
+void
+SwapArea::readSlot(int slot, char *into)
+{
+    ASSERT(slots->Test(slot));
+    Lseek(fd, slot * PageSize, 0);
+    Read(fd, into, PageSize);
+}
+
+void
+SwapArea::writeSlot(int slot, char *from)
+{
+    ASSERT(slots->Test(slot));
+    Lseek(fd, slot * PageSize, 0);
+    WriteFile(fd, from, PageSize);
+}
@@ -0,0 +1,38 @@
+#ifndef __USERPROG_SWAP_H__
+#define __USERPROG_SWAP_H__
+#include "bitmap.h"
+
+#define NumSwapPages 4096	// # of pages the swap area holds
+
+// The swap area: where the pages of user programs go when they are
+// evicted from main memory while dirty, one page to a slot.  It is a
+// UNIX file ("SWAP_<host id>", so that the machines of a farm each
+// have their own), grown as slots are first written, and removed
+// when Nachos halts.
+//
+// A slot can be shared by the pages of several processes (after a
+// copy-on-write Fork; see AddrSpace::Fork): it has a reference count,
+// and is freed when the last of them lets go of it.
+//
+// Reading and writing a slot doesn't wait for a simulated device, so
+// (unlike the disk) nothing here can block the calling thread.
+
+class SwapArea
+{
+    public:
+        SwapArea();
+        ~SwapArea();
+        int allocSlot();        // a free slot; there must be one
+        void shareSlot(int slot);       // one more page refers to "slot"
+        void freeSlot(int slot);        // and one fewer
+        bool isShared(int slot) { return refs[slot] > 1; }
+        void readSlot(int slot, char *into);    // PageSize bytes
+        void writeSlot(int slot, char *from);
+    private:
+        char name[32];          // the UNIX file
+        int fd;
+        Bitmap *slots;          // which slots are in use
+        int *refs;              // how many pages refer to each slot
+};
+
+#endif